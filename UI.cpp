@@ -5,7 +5,15 @@
 #include <string>
 #include <algorithm>
 #include <fstream>
+#include <cstdio>
+#include <thread>
+#include <chrono>
+#include <memory>
 #include "solver.h"
+#include "cache.h"
+#include "server.h"
+#include "generator.h"
+#include "regress.h"
 
 using namespace std;
 typedef struct Graph graph;
@@ -139,28 +147,81 @@ string graph2StrV2(struct Graph g, int colorMode) {
 	return res;
 }
 
-// Converts a board to a string. Does not validate inputs.
-string board2Str(board b, int colorMode, bool drawBorders) {
-	string res;
-	if (drawBorders) {
-		res += "┌";
-		for (uint i = 0; i < b[0].size(); i++) res += "─";
-		res += "┐\n";
+// Renders boards into a single reusable buffer.
+// The string for each color is built once, rather than once per cell,
+// and the buffer keeps its capacity between frames.
+class BoardRenderer {
+protected:
+	vector<string> cells; // The printable string for each color.
+	uint cellSize = 0; // The length of the longest cell string.
+	string buffer; // The output of the last render.
+	string other; // Used for colors with no precomputed string.
+	int colorMode;
+	bool drawBorders;
+	
+	// The printable string for a color.
+	const string & cell(int color) {
+		if (color >= 0 and (uint)color < cells.size()) return cells[color];
+		other = mColored(color,colorMode);
+		return other;
 	}
-	for (auto row : b) {
-		if (drawBorders) res += "│";
-		for (auto val : row) {
-			res += mColored(val,colorMode);
+	
+public:
+	BoardRenderer(int colorMode, bool drawBorders) : colorMode(colorMode), drawBorders(drawBorders) {
+		for (int i = 0; i < 36; i++) {
+			cells.push_back(mColored(i,colorMode));
+			cellSize = max(cellSize,(uint)cells.back().size());
 		}
-		if (drawBorders) res += "│";
-		res += "\n";
 	}
-	if (drawBorders) {
-		res += "└";
-		for (uint i = 0; i < b[0].size(); i++) res += "─";
-		res += "┘\n";
+	
+	// Converts a board to a string. Does not validate inputs.
+	const string & render(const board & b) {
+		uint width = b[0].size();
+		buffer.clear();
+		// Longest cell string, plus borders and a newline, for each row.
+		buffer.reserve((b.size() + 2) * (width * max(cellSize,3u) + 8));
+		if (drawBorders) {
+			buffer += "┌";
+			for (uint i = 0; i < width; i++) buffer += "─";
+			buffer += "┐\n";
+		}
+		for (auto & row : b) {
+			if (drawBorders) buffer += "│";
+			for (int val : row) buffer += cell(val);
+			if (drawBorders) buffer += "│";
+			buffer += '\n';
+		}
+		if (drawBorders) {
+			buffer += "└";
+			for (uint i = 0; i < width; i++) buffer += "─";
+			buffer += "┘\n";
+		}
+		return buffer;
 	}
-	return res;
+	
+	// Redraws only the cells that differ between two boards, in place.
+	// Assumes 'prev' was the last thing rendered, and the cursor is on the line below it.
+	const string & renderChanges(const board & prev, const board & next) {
+		int lines = next.size() + (drawBorders ? 2 : 0);
+		int offset = drawBorders ? 1 : 0;
+		buffer.clear();
+		for (uint y = 0; y < next.size(); y++) {
+			for (uint x = 0; x < next[y].size(); x++) {
+				if (prev[y][x] == next[y][x]) continue;
+				int up = lines - (y + offset);
+				// Move up to the row, across to the column, draw, and return.
+				buffer += "\033[" + to_string(up) + "A\033[" + to_string(x + offset + 1) + "G";
+				buffer += cell(next[y][x]);
+				buffer += "\033[" + to_string(up) + "B\r";
+			}
+		}
+		return buffer;
+	}
+};
+
+// Converts a board to a string. Does not validate inputs.
+string board2Str(board b, int colorMode, bool drawBorders) {
+	return BoardRenderer(colorMode,drawBorders).render(b);
 }
 
 // Checks if the first input is a prefix of the second.
@@ -184,6 +245,59 @@ void printHelp(bool debug) {
 	cout << "\t-help       This page.\n";
 	cout << "\t-help=d     This page, with debugging arguments.\n";
 	cout << "\t-t=time     Stop solver after <time> seconds. Integers only.\n";
+	cout << "\t-nodes=n    Stop solver after processing <n> partial paths.\n";
+	cout << "\t-engine=e   The search algorithm to use:\n";
+	cout << "\t            best:  best-first search, with duplicate detection (default).\n";
+	cout << "\t            fixed: iterative deepening over fixed-size states. Uses little memory.\n";
+	cout << "\t                   Only for boards of up to 1024 zones and 64 colors.\n";
+	cout << "\t            external: breadth-first, keeping the frontier in files on disk.\n";
+	cout << "\t                   For boards whose search does not fit in memory.\n";
+	cout << "\t            parallel: depth-first iterative deepening on several threads (see '-threads=').\n";
+	cout << "\t            hierarchical: solves regions of the board on their own, then the board they\n";
+	cout << "\t                   leave. Fast on huge boards, but not always optimal.\n";
+	cout << "\t            mcts: Monte Carlo tree search on several threads (see '-threads='). Has a\n";
+	cout << "\t                   solution at once, and better ones the longer it runs ('-t=').\n";
+	cout << "\t            auto: picks one of these (and '-orderMoves', '-symmetry') from the board's zones,\n";
+	cout << "\t                   colors, diameter and symmetries, and whether '-t=' or '-max=' is given.\n";
+	cout << "\t                   Says which.\n";
+	cout << "\t-regionSize=n  Most zones in a region for '-engine=hierarchical' (default 16).\n";
+	cout << "\t-regionNodes=n  Partial paths '-engine=hierarchical' may process per region (default 20000).\n";
+	cout << "\t-strategy=s The search order and pruning for the default engine. All find optimal solutions:\n";
+	cout << "\t            classic: fewest zones first, with exact duplicate detection (default).\n";
+	cout << "\t            astar:   fewest moves made plus moves needed first, with lower bound pruning.\n";
+	cout << "\t            greedy:  fewest moves needed first. Finds a first solution quickly.\n";
+	cout << "\t            lean:    like classic, with hashed duplicate detection and lower bound pruning.\n";
+	cout << "\t            bucket:  like astar, with an open list of one bucket per moves made plus needed.\n";
+	cout << "\t            These two stop once the solution is proven within '-eps=' of optimal:\n";
+	cout << "\t            weighted: weighted A*, with the moves still needed counted 1+eps times.\n";
+	cout << "\t            focal:   fewest zones first, among paths within 1+eps of the best bound.\n";
+	cout << "\t-tieBreak=t Which path '-strategy=bucket' searches first, out of a bucket:\n";
+	cout << "\t            'deepest' (most moves made, the default), 'fifo' (first in) or 'lifo' (last in).\n";
+	cout << "\t-eps=x      How much longer than optimal a solution may be, as a fraction (default 0.1).\n";
+	cout << "\t            Uses '-strategy=weighted' unless another strategy is given.\n";
+	cout << "\t-checkpoint=<file>  Save the default engine's search to a file every so often, and when it\n";
+	cout << "\t            runs out of time ('-t') or board states ('-nodes'), so it can be resumed.\n";
+	cout << "\t-checkpointEvery=n  Seconds between checkpoints (default 300).\n";
+	cout << "\t-resume=<file>  Carry on the search saved with '-checkpoint'. It still proves optimality.\n";
+	cout << "\t-trace=<file>  Record the default engine's open list size, duplicate table size, best solution,\n";
+	cout << "\t            nodes per second and depths searched over time. A '.json' file gets Chrome's\n";
+	cout << "\t            trace format (for chrome://tracing or Perfetto); anything else gets CSV.\n";
+	cout << "\t-traceInterval=n  Milliseconds between trace samples (default 100).\n";
+	cout << "\t-orderMoves  Try the most promising moves first: the move that went deepest last time at\n";
+	cout << "\t            that depth, moves next to the last one, moves with good history, central zones.\n";
+	cout << "\t            Finds solutions sooner, but may pick a different optimal one.\n";
+	cout << "\t-symmetry   Skip moves that are mirror images of another move, under the board's automorphisms.\n";
+	cout << "\t            May pick a different optimal solution. Not used by '-engine=fixed'.\n";
+	cout << "\t-spill=<dir>  Where '-engine=external' keeps its files (default /tmp).\n";
+	cout << "\t-memory=n   Megabytes of states '-engine=external' sorts in memory at once (default 256).\n";
+	cout << "\t-moves      Print the solution as a list of moves, one '(x, y, color)' per line.\n";
+	cout << "\t            x and y count from 0, starting at the top left.\n";
+	cout << "\t-json       Print the solution as a list of moves, in JSON.\n";
+	cout << "\t-edit=x,y,c  Solve, then recolor cell (x,y) to c and solve again, reusing what it can.\n";
+	cout << "\t            Can be given more than once. The edited board's solution is printed.\n";
+	cout << "\t-countSolutions  Count the distinct optimal move sequences, instead of printing one.\n";
+	cout << "\t-list=n     Same, and also print the first n of them as move lists.\n";
+	cout << "\t-animate    Print the solution as a single board, redrawing only the changed cells after each move.\n";
 	if (debug) {
 		cout << "\n";
 		cout << "debugging tools:\n";
@@ -204,6 +318,33 @@ void printHelp(bool debug) {
 	cout << "\n";
 	cout << "file inputs:\n";
 	cout << "\t-s=<file>   A solution file to color and print out. Use -c0 to -c3 to select coloring.\n";
+	cout << "\nboard generator:\n";
+	cout << "\t-generate=k Print a random board instead of solving. k is 'uniform', 'blobby' or 'planted'.\n";
+	cout << "\t            Planted boards come with a '-max=' line, since their solution length is known.\n";
+	cout << "\t-size=WxH   Size of the generated board (default 8x8).\n";
+	cout << "\t-palette=n  Number of colors in the generated board, up to 10 (default 4).\n";
+	cout << "\t-seed=n     Seed for the generator (default 1).\n";
+	cout << "\t-plant=n    Number of moves to plant in a planted board (default 5).\n";
+	cout << "\nregression tests:\n";
+	cout << "\t-regress[=<dir>]  Solve every level in a directory (default 3ds_levels) and check each solution\n";
+	cout << "\t            is valid and optimal. Exits with 4 if any level fails.\n";
+	cout << "\t-solutions=<dir>  Recorded solutions to take the optimal move counts from (default 3ds_solutions).\n";
+	cout << "\t-engines=e,e  Engines to solve each level with, which must agree (default best).\n";
+	cout << "\t-baseline=<file>  Times and node counts to compare against. Slower or larger runs fail.\n";
+	cout << "\t-saveBaseline  Store this run's times and node counts to the '-baseline=' file instead.\n";
+	cout << "\t-tolerance=n  Percent a level may grow past its baseline (default 50).\n";
+	cout << "\t-noHints    Ignore the '-min=' and '-max=' lines in level files.\n";
+	cout << "\nserver mode:\n";
+	cout << "\t-serve      Solve boards sent as JSON on stdin, one per line, and reply with JSON on stdout.\n";
+	cout << "\t            e.g. {\"id\": 1, \"board\": [\"112\", \"221\"], \"t\": 5, \"nodes\": 100000, \"min\": 2, \"max\": 2}\n";
+	cout << "\t            Only \"board\" is required. '-t=' and '-nodes=' set the defaults for each request.\n";
+	cout << "\t-socket=<path>  Same, but listen on a Unix domain socket instead.\n";
+	cout << "\t-threads=n  Number of requests to solve at once (default: one per CPU core).\n";
+	cout << "\t            Also the number of threads '-engine=parallel' and '-engine=mcts' use.\n";
+	cout << "\n";
+	cout << "\t-cache=<file>   A solution cache to check before solving, and to store new solutions in.\n";
+	cout << "\t-cacheSize=n    The most solutions to keep in the cache (default 10000). Least recently used are dropped first.\n";
+	cout << "\t-verify=<file>  A move list (from -moves or -json) to check against the input board, instead of solving.\n";
 	cout << "\t<filename>  A file to automatically open and use for input.\n";
 }
 
@@ -258,6 +399,85 @@ void colorFile(ifstream & file, int colorMode) {
 	cout << '\n';
 }
 
+// Reads a move list, as written by '-moves' or '-json'.
+// Any group of exactly three ints inside '()' or '{}' is taken as an x, y, color triple.
+// Lines starting with '#' are ignored.
+vector<Move> readMoves(ifstream & file) {
+	vector<Move> result;
+	vector<int> group; // The ints seen since the last opening bracket.
+	string num;
+	bool lineStart = true;
+	char c;
+	while (file.get(c)) {
+		if (lineStart and c == '#') {
+			while (c != '\n' and file.get(c)) {}
+			continue;
+		}
+		lineStart = (c == '\n');
+		if ((c >= '0' and c <= '9') or (c == '-' and num.empty())) {
+			num += c;
+			continue;
+		}
+		if (!num.empty() and num != "-") group.push_back(stoi(num));
+		num = "";
+		if (c == '(' or c == '{') {
+			group.clear();
+		} else if (c == ')' or c == '}') {
+			if (group.size() == 3) {
+				Move m;
+				m.zone = -1;
+				m.x = group[0];
+				m.y = group[1];
+				m.color = group[2];
+				result.push_back(m);
+			}
+			group.clear();
+		}
+	}
+	return result;
+}
+
+// Replays a move list on a board. Returns the exit code to use.
+int verifyMoves(board b, vector<Move> & moves, int colorMode, bool drawBorders, int minSol) {
+	int height = b.size();
+	int width = b[0].size();
+	for (uint i = 0; i < moves.size(); i++) {
+		Move & m = moves[i];
+		if (m.x < 0 or m.y < 0 or m.x >= width or m.y >= height) {
+			cout << "Invalid move " << i+1 << ": (" << m.x << ", " << m.y << ") is not on the board.\n";
+			return 3;
+		}
+		if (applyMove(b,m.x,m.y,m.color) == 0) {
+			cout << "Invalid move " << i+1 << ": (" << m.x << ", " << m.y << ") is already color " << m.color << ".\n";
+			return 3;
+		}
+	}
+	for (auto & row : b) {
+		for (int val : row) {
+			if (val == b[0][0]) continue;
+			cout << "Not solved: board is not a single color after " << moves.size() << " moves.\n";
+			cout << board2Str(b,colorMode,drawBorders);
+			return 3;
+		}
+	}
+	cout << "Valid solution in " << moves.size() << " moves.\n";
+	if (minSol > 0 and (int)moves.size() > minSol) {
+		cout << "Note: expected " << minSol << " moves.\n";
+		return 3;
+	}
+	return 0;
+}
+
+// The peak resident memory of this process, in KB, or -1 if unknown. (Linux only.)
+long peakMemoryKB() {
+	ifstream status("/proc/self/status");
+	string line;
+	while (getline(status,line)) {
+		if (isPrefix("VmHWM:",line)) return stol(line.substr(6));
+	}
+	return -1;
+}
+
 // The main routine for the solver.
 int main(int argc, char ** argv) {
 	// Handle args.
@@ -278,7 +498,42 @@ int main(int argc, char ** argv) {
 	int minSol = 0; // The cutoff for when to return a solution.
 	int maxSol = -1; // The cutoff for solutions to ignore. -1 means no cutoff.
 	uint maxTime = 0; // The maximum time. '0' means 'none'
+	unsigned long maxNodes = 0; // The maximum number of partial paths to process. '0' means 'none'
 	int colorMode = 3; // The color mode to use.
+	int outputMode = 0; // 0 for boards, 1 for '-moves', 2 for '-json', 3 for '-animate'.
+	bool verify = false; // Decides if we are checking a move list instead of solving.
+	ifstream verifyFile; // File to use, if applicable.
+	string inputName; // The input file name, if applicable.
+	string cachePath; // The solution cache to use, if any.
+	uint cacheSize = 10000; // The most entries to keep in the cache.
+	Engine engine = Engine::BestFirst; // The search algorithm to use.
+	Strategy strategy = Strategy::Classic; // The policies the default engine uses.
+	TieBreak tieBreak = TieBreak::Deepest; // Which path in a bucket goes first, for '-strategy=bucket'.
+	bool strategyGiven = false; // Set if '-strategy=' was used.
+	double epsilon = -1; // How far from optimal a solution may be, if '-eps=' was used.
+	string tracePath; // Where to write a trace of the search, if anywhere.
+	string checkpointPath; // Where to save the search, if anywhere.
+	uint checkpointEvery = 300; // Seconds between checkpoints.
+	string resumePath; // A saved search to carry on, if any.
+	uint traceInterval = 100; // Milliseconds between trace samples.
+	bool orderMoves = false; // Search promising moves first.
+	uint regionSize = 16; // Zones per region, for the hierarchical engine.
+	unsigned long regionNodes = 20000; // Node budget per region, for the hierarchical engine.
+	bool symmetry = false; // Skip symmetric moves.
+	string spillDir = "/tmp"; // Where the external engine keeps its files.
+	unsigned long memoryLimit = 256; // Megabytes the external engine sorts at once.
+	bool generate = false; // Decides if we are generating a board instead.
+	BoardKind genKind = BoardKind::Uniform;
+	int genWidth = 8, genHeight = 8, genColors = 4, genMoves = 5;
+	unsigned int genSeed = 1;
+	bool serve = false; // Decides if we are running as a server.
+	vector<CellEdit> edits; // Cells to recolor after solving, before solving again.
+	bool countMode = false; // Decides if we are counting optimal solutions instead.
+	uint listCount = 0; // The number of optimal solutions to list, when counting.
+	bool regress = false; // Decides if we are running the regression tests.
+	RegressOptions regressOptions;
+	ServerOptions serverOptions;
+	serverOptions.threads = thread::hardware_concurrency();
 	for (int i = 1; i < argc; i++) {
 		string arg = argv[i];
 		if (arg == "-zones") {
@@ -306,6 +561,12 @@ int main(int argc, char ** argv) {
 			colorMode = 2;
 		} else if (arg == "-c3") {
 			colorMode = 3;
+		} else if (arg == "-moves") {
+			outputMode = 1;
+		} else if (arg == "-json") {
+			outputMode = 2;
+		} else if (arg == "-animate") {
+			outputMode = 3;
 		} else if (arg == "-borders") {
 			drawBorders = true;
 		} else if (arg == "-colors") {
@@ -325,6 +586,86 @@ int main(int argc, char ** argv) {
 				cout << "time must be an int greater than 0!\n";
 				exit(1);
 			}
+		} else if (isPrefix("-nodes=",arg)) {
+			maxNodes = stoul(arg.substr(7));
+			if (maxNodes == 0) {
+				cout << "invalid arg: '" + arg + "'\n";
+				cout << "node limit must be an int greater than 0!\n";
+				exit(1);
+			}
+		} else if (isPrefix("-engine=",arg)) {
+			if (!parseEngine(arg.substr(8),engine)) {
+				cout << "invalid arg: '" + arg + "'\n";
+				cout << "engine must be 'best', 'fixed', 'external', 'parallel', 'hierarchical', 'mcts' or 'auto'!\n";
+				exit(1);
+			}
+		} else if (isPrefix("-strategy=",arg)) {
+			if (!parseStrategy(arg.substr(10),strategy)) {
+				cout << "invalid arg: '" + arg + "'\n";
+				cout << "strategy must be 'classic', 'astar', 'greedy', 'lean', 'bucket', 'weighted' or 'focal'!\n";
+				exit(1);
+			}
+			strategyGiven = true;
+		} else if (isPrefix("-tieBreak=",arg)) {
+			if (!parseTieBreak(arg.substr(10),tieBreak)) {
+				cout << "invalid arg: '" + arg + "'\n";
+				cout << "tie break must be 'deepest', 'fifo' or 'lifo'!\n";
+				exit(1);
+			}
+		} else if (isPrefix("-eps=",arg)) {
+			epsilon = stod(arg.substr(5));
+			if (epsilon < 0) {
+				cout << "invalid arg: '" + arg + "'\n";
+				cout << "eps must be a number of at least 0!\n";
+				exit(1);
+			}
+		} else if (isPrefix("-checkpoint=",arg)) {
+			checkpointPath = arg.substr(12);
+		} else if (isPrefix("-checkpointEvery=",arg)) {
+			checkpointEvery = stoi(arg.substr(17));
+			if (checkpointEvery == 0) {
+				cout << "invalid arg: '" + arg + "'\n";
+				cout << "checkpoint interval must be an int greater than 0!\n";
+				exit(1);
+			}
+		} else if (isPrefix("-resume=",arg)) {
+			resumePath = arg.substr(8);
+		} else if (isPrefix("-trace=",arg)) {
+			tracePath = arg.substr(7);
+		} else if (isPrefix("-traceInterval=",arg)) {
+			traceInterval = stoi(arg.substr(15));
+			if (traceInterval == 0) {
+				cout << "invalid arg: '" + arg + "'\n";
+				cout << "trace interval must be an int greater than 0!\n";
+				exit(1);
+			}
+		} else if (isPrefix("-regionSize=",arg)) {
+			regionSize = stoi(arg.substr(12));
+			if (regionSize < 2) {
+				cout << "invalid arg: '" + arg + "'\n";
+				cout << "region size must be an int of at least 2!\n";
+				exit(1);
+			}
+		} else if (isPrefix("-regionNodes=",arg)) {
+			regionNodes = stoul(arg.substr(13));
+			if (regionNodes == 0) {
+				cout << "invalid arg: '" + arg + "'\n";
+				cout << "region nodes must be an int greater than 0!\n";
+				exit(1);
+			}
+		} else if (arg == "-orderMoves") {
+			orderMoves = true;
+		} else if (arg == "-symmetry") {
+			symmetry = true;
+		} else if (isPrefix("-spill=",arg)) {
+			spillDir = arg.substr(7);
+		} else if (isPrefix("-memory=",arg)) {
+			memoryLimit = stoul(arg.substr(8));
+			if (memoryLimit == 0) {
+				cout << "invalid arg: '" + arg + "'\n";
+				cout << "memory must be an int greater than 0!\n";
+				exit(1);
+			}
 		} else if (isPrefix("-min=",arg)) {
 			minSol = stoi(arg.substr(5));
 			if (minSol == 0) {
@@ -347,6 +688,114 @@ int main(int argc, char ** argv) {
 				exit(1);
 			}
 			fileSol = true;
+		} else if (isPrefix("-generate=",arg)) {
+			string kind = arg.substr(10);
+			generate = true;
+			if (kind == "uniform") {
+				genKind = BoardKind::Uniform;
+			} else if (kind == "blobby") {
+				genKind = BoardKind::Blobby;
+			} else if (kind == "planted") {
+				genKind = BoardKind::Planted;
+			} else {
+				cout << "invalid arg: '" + arg + "'\n";
+				cout << "board kind must be 'uniform', 'blobby' or 'planted'!\n";
+				exit(1);
+			}
+		} else if (isPrefix("-size=",arg)) {
+			string size = arg.substr(6);
+			size_t x = size.find('x');
+			if (x != string::npos) {
+				genWidth = stoi(size.substr(0,x));
+				genHeight = stoi(size.substr(x + 1));
+			}
+			if (x == string::npos or genWidth <= 0 or genHeight <= 0) {
+				cout << "invalid arg: '" + arg + "'\n";
+				cout << "size must look like '8x6'!\n";
+				exit(1);
+			}
+		} else if (isPrefix("-palette=",arg)) {
+			genColors = stoi(arg.substr(9));
+			if (genColors <= 0 or genColors > 10) {
+				cout << "invalid arg: '" + arg + "'\n";
+				cout << "palette must be from 1 to 10 colors!\n";
+				exit(1);
+			}
+		} else if (isPrefix("-seed=",arg)) {
+			genSeed = stoul(arg.substr(6));
+		} else if (isPrefix("-plant=",arg)) {
+			genMoves = stoi(arg.substr(7));
+		} else if (isPrefix("-edit=",arg)) {
+			CellEdit e;
+			if (sscanf(arg.c_str(),"-edit=%d,%d,%d",&e.x,&e.y,&e.color) != 3 or e.x < 0 or e.y < 0 or e.color < 0 or e.color > 9) {
+				cout << "invalid arg: '" + arg + "'\n";
+				cout << "edits must look like '-edit=x,y,color'!\n";
+				exit(1);
+			}
+			edits.push_back(e);
+		} else if (arg == "-countSolutions") {
+			countMode = true;
+		} else if (isPrefix("-list=",arg)) {
+			countMode = true;
+			listCount = stoi(arg.substr(6));
+		} else if (arg == "-regress" or isPrefix("-regress=",arg)) {
+			regress = true;
+			if (arg.size() > 8) regressOptions.levelsDir = arg.substr(9);
+		} else if (isPrefix("-solutions=",arg)) {
+			regressOptions.solutionsDir = arg.substr(11);
+		} else if (isPrefix("-engines=",arg)) {
+			regressOptions.engines.clear();
+			string list = arg.substr(9) + ",";
+			for (size_t start = 0, end; (end = list.find(',',start)) != string::npos; start = end + 1) {
+				Engine e;
+				if (!parseEngine(list.substr(start,end - start),e)) {
+					cout << "invalid arg: '" + arg + "'\n";
+					cout << "engines must be a comma-separated list of 'best', 'fixed', 'external', 'parallel', 'hierarchical', 'mcts' or 'auto'!\n";
+					exit(1);
+				}
+				regressOptions.engines.push_back(e);
+			}
+		} else if (isPrefix("-baseline=",arg)) {
+			regressOptions.baselinePath = arg.substr(10);
+		} else if (arg == "-saveBaseline") {
+			regressOptions.saveBaseline = true;
+		} else if (isPrefix("-tolerance=",arg)) {
+			regressOptions.tolerance = stoi(arg.substr(11));
+			if (regressOptions.tolerance < 0) {
+				cout << "invalid arg: '" + arg + "'\n";
+				cout << "tolerance must be an int of at least 0!\n";
+				exit(1);
+			}
+		} else if (arg == "-noHints") {
+			regressOptions.useHints = false;
+		} else if (arg == "-serve") {
+			serve = true;
+		} else if (isPrefix("-socket=",arg)) {
+			serve = true;
+			serverOptions.socketPath = arg.substr(8);
+		} else if (isPrefix("-threads=",arg)) {
+			serverOptions.threads = stoi(arg.substr(9));
+			if (serverOptions.threads == 0) {
+				cout << "invalid arg: '" + arg + "'\n";
+				cout << "thread count must be an int greater than 0!\n";
+				exit(1);
+			}
+		} else if (isPrefix("-cache=",arg)) {
+			cachePath = arg.substr(7);
+		} else if (isPrefix("-cacheSize=",arg)) {
+			cacheSize = stoi(arg.substr(11));
+			if (cacheSize == 0) {
+				cout << "invalid arg: '" + arg + "'\n";
+				cout << "cache size must be an int greater than 0!\n";
+				exit(1);
+			}
+		} else if (isPrefix("-verify=",arg)) {
+			verifyFile.open(arg.substr(8));
+			if (!verifyFile.is_open()) {
+				cout << "Failed to open move file: " << arg.substr(8) << "\n";
+				exit(1);
+			}
+			verify = true;
 		} else {
 			inputFile.open(arg);
 			if (!inputFile.is_open()) {
@@ -354,11 +803,20 @@ int main(int argc, char ** argv) {
 				cout << "use '-help' for help.\n";
 				exit(1);
 			}
-			cout << "input file '" + arg + "' successfully opened\n";
+			inputName = arg;
 			fileInput = true;
 			noUserMessage = true;
 		}
 	}
+	if (epsilon >= 0 and !strategyGiven) strategy = Strategy::Weighted;
+	if ((checkpointPath != "" or resumePath != "") and engine != Engine::BestFirst and engine != Engine::Auto) {
+		cout << "'-checkpoint' and '-resume' only work with the default engine ('-engine=best' or '-engine=auto')!\n";
+		exit(1);
+	}
+	// Machine-readable output should contain nothing else.
+	if (fileInput and (outputMode == 0 or outputMode == 3)) {
+		cout << "input file '" + inputName + "' successfully opened\n";
+	}
 	if (colorTest) {
 		for (int mode = 0; mode <= 3; mode++) {
 			cout << "-c" << mode << ":   ";
@@ -375,6 +833,32 @@ int main(int argc, char ** argv) {
 		return 0;
 	}
 	
+	if (generate) {
+		auto b = generateBoard(genKind,genWidth,genHeight,genColors,genSeed,genMoves);
+		for (auto & row : b) {
+			for (int val : row) cout << val;
+			cout << "\n";
+		}
+		if (genKind == BoardKind::Planted) cout << "\n-max=" << genMoves << "\n";
+		return 0;
+	}
+	
+	if (regress) {
+		regressOptions.maxTime = maxTime;
+		regressOptions.strategy = strategy;
+		regressOptions.orderMoves = orderMoves;
+		return runRegression(regressOptions);
+	}
+	
+	if (serve) {
+		unique_ptr<SolutionCache> cache;
+		if (cachePath != "") cache = make_unique<SolutionCache>(cachePath,cacheSize);
+		serverOptions.cache = cache.get();
+		serverOptions.maxTime = maxTime;
+		serverOptions.maxNodes = maxNodes;
+		return runServer(serverOptions);
+	}
+	
 	if (!noUserMessage) {
 		cout << "Please enter a grid of digits from 0-9. This will represent the game board.\n";
 		cout << "Spaces and empty lines will be safely ignored.\n";
@@ -467,6 +951,10 @@ int main(int argc, char ** argv) {
 		cout << board2Str(board,colorMode,drawBorders);
 		cout << "\n";
 	}
+	if (verify) {
+		vector<Move> moves = readMoves(verifyFile);
+		return verifyMoves(board,moves,colorMode,drawBorders,minSol);
+	}
 	// Generate zone graph.
 	int zoneCount; // The number of zones.
 	vector<int> zoneColors; // The colors of each zone
@@ -492,24 +980,161 @@ int main(int argc, char ** argv) {
 	
 	
 	// Generate solution (via solver.cpp)
-	vector<vector<vector<int>>> sequence;
-	vector<graph> gHistory;
-	uint loopCount = 0;
-	if (showCount) loopCount = 1;
-	bool perfect = solve(startingGraph,zoneBoard,sequence,gHistory,maxTime,loopCount,minSol,maxSol);
+	SolveOptions options;
+	options.maxTime = maxTime;
+	options.maxNodes = maxNodes;
+	options.minSol = minSol;
+	options.maxSol = maxSol;
+	options.showCount = showCount;
+	options.engine = engine;
+	options.strategy = strategy;
+	options.tieBreak = tieBreak;
+	if (epsilon >= 0) options.epsilon = epsilon;
+	options.tracePath = tracePath;
+	options.checkpointPath = checkpointPath;
+	options.checkpointEvery = checkpointEvery;
+	options.resumePath = resumePath;
+	options.traceInterval = traceInterval;
+	options.orderMoves = orderMoves;
+	options.regionSize = regionSize;
+	options.regionNodes = regionNodes;
+	options.symmetry = symmetry;
+	options.spillDir = spillDir;
+	options.memoryLimit = memoryLimit;
+	options.threads = serverOptions.threads;
+	if (countMode) {
+		CountResult counted;
+		uint listed = 0;
+		options.quiet = true;
+		bool complete = countSolutions(startingGraph,zoneBoard,options,listCount,[&](const vector<Move> & solution) {
+			cout << "Solution " << ++listed << ":\n";
+			for (auto & m : solution) {
+				cout << "(" << m.x << ", " << m.y << ", " << m.color << ")\n";
+			}
+			cout << "\n";
+		},counted);
+		if (counted.moves == -1) {
+			cout << (complete ? "No solution found.\n" : "Timed out without finding a solution.\n");
+		} else {
+			cout << "Optimal moves: " << counted.moves << "\n";
+			cout << "Optimal solutions: " << counted.solutions << (complete ? "" : " or more (timed out)") << "\n";
+		}
+		if (showCount) {
+			cout << "Number of board states processed: " + to_string(counted.iterations) + "\n";
+			cout << "Peak memory: " << peakMemoryKB() << " KB\n";
+		}
+		return 0;
+	}
+	SolveResult result;
+	bool perfect = false;
+	bool cached = false;
+	unique_ptr<SolutionCache> cache;
+	if (cachePath != "" and edits.size() == 0) {
+		cache = make_unique<SolutionCache>(cachePath,cacheSize);
+		vector<Move> found;
+		bool proven;
+		if (cache->lookup(startingGraph,minSol,maxSol,found,proven) and replay(startingGraph,zoneBoard,found,result)) {
+			result.proven = proven;
+			cached = true;
+			perfect = true;
+			if (showCount) cout << "Loaded solution from cache.\n";
+		}
+	}
+	if (edits.size() > 0) {
+		// Solve, then edit and solve again incrementally, like a level editor would.
+		for (auto & e : edits) {
+			if ((uint)e.y >= board.size() or (uint)e.x >= board[0].size()) {
+				cerr << "Bad input: edit at (" << e.x << ", " << e.y << ") is outside the board!\n";
+				exit(2);
+			}
+		}
+		SolveSession session;
+		auto start = chrono::steady_clock::now();
+		startSession(board,options,session);
+		auto edited = chrono::steady_clock::now();
+		// The level's hints were for the board before the edits.
+		SolveOptions editOptions = options;
+		editOptions.minSol = 0;
+		editOptions.maxSol = -1;
+		perfect = resolve(session,edits,editOptions);
+		auto done = chrono::steady_clock::now();
+		result = session.result;
+		zoneCount = session.graph.nodeCount;
+		if (showCount) {
+			cout << "First solve: " << chrono::duration_cast<chrono::milliseconds>(edited - start).count() << " ms.\n";
+			cout << "Solve after edits: " << chrono::duration_cast<chrono::milliseconds>(done - edited).count() << " ms.\n";
+		}
+	} else if (!cached) {
+		perfect = solve(startingGraph,zoneBoard,options,result);
+		if (cache != nullptr and perfect and result.moves.size() > 0) {
+			cache->store(startingGraph,result.moves,result.proven);
+		}
+	}
+	vector<vector<vector<int>>> & sequence = result.boards;
+	vector<graph> & gHistory = result.graphs;
+	vector<Move> & moves = result.moves;
+	unsigned long loopCount = result.iterations;
 	
-	if (sequence.size() > 0) {
+	if (outputMode == 1) {
+		if (sequence.size() == 0) {
+			cout << "# No solution found.\n";
+		} else if (!perfect) {
+			cout << "# Timed out. Solution may not be optimal.\n";
+		} else if (!result.proven and minSol > 0 and (unsigned)minSol == moves.size()) {
+			cout << "# A solution in " << minSol << " moves or fewer.\n";
+		} else if (!result.proven and result.lowerBound > 0) {
+			cout << "# Solution within " << options.epsilon * 100 << "% of optimal (optimal is at least " << result.lowerBound << " moves).\n";
+		} else if (!result.proven) {
+			cout << "# Solution not proven optimal.\n";
+		}
+		for (auto & m : moves) {
+			cout << "(" << m.x << ", " << m.y << ", " << m.color << ")\n";
+		}
+	} else if (outputMode == 2) {
+		cout << "{\"solved\": " << (sequence.size() > 0 ? "true" : "false");
+		cout << ", \"optimal\": " << (perfect and result.proven and sequence.size() > 0 ? "true" : "false");
+		cout << ", \"moveCount\": " << moves.size() << ", \"moves\": [";
+		for (uint i = 0; i < moves.size(); i++) {
+			if (i > 0) cout << ",";
+			cout << "\n  {\"x\": " << moves[i].x << ", \"y\": " << moves[i].y << ", \"color\": " << moves[i].color << "}";
+		}
+		cout << "\n]}\n";
+	} else if (outputMode == 3 and sequence.size() > 0) {
+		BoardRenderer renderer(colorMode,drawBorders);
+		cout << renderer.render(sequence[0]) << flush;
+		for (uint i = 1; i < sequence.size(); i++) {
+			this_thread::sleep_for(chrono::milliseconds(500));
+			cout << renderer.renderChanges(sequence[i-1],sequence[i]) << flush;
+		}
+		cout << "\n" << moves.size() << " moves";
+		if (!perfect) {
+			cout << " (timed out, may not be optimal).\n";
+		} else if (!result.proven and minSol > 0 and (unsigned)minSol == moves.size()) {
+			cout << " (as short as the '-min=' hint).\n";
+		} else if (!result.proven and result.lowerBound > 0) {
+			cout << " (within " << options.epsilon * 100 << "% of optimal).\n";
+		} else if (!result.proven) {
+			cout << " (not proven optimal).\n";
+		} else {
+			cout << " (optimal).\n";
+		}
+	} else if (sequence.size() > 0) {
 		// Print results.
 		if (minSol > 0 and (unsigned)minSol == sequence.size()-1) {
 			cout << "A solution in " << minSol << " moves or fewer:\n\n";
+		} else if (perfect and !result.proven and result.lowerBound > 0) {
+			cout << "A solution within " << options.epsilon * 100 << "% of optimal (optimal is at least " << result.lowerBound << " moves):\n\n";
+		} else if (perfect and !result.proven and result.engine == Engine::Hierarchical) {
+			cout << "A solution (not proven optimal):\n\n";
 		} else if (perfect) {
 			cout << "An optimal solution:\n\n";
 		} else {
 			cout << "Timed out. Best path found:\n\n";
 		}
+		BoardRenderer renderer(colorMode,drawBorders);
 		for (uint i = 0; i < sequence.size(); i++) {
-			cout << board2Str(sequence[i],colorMode,drawBorders);
-			if (graphHistory) cout << graph2StrV2(gHistory[i],colorMode) << "\n";
+			cout << renderer.render(sequence[i]);
+			if (graphHistory and i < gHistory.size()) cout << graph2StrV2(gHistory[i],colorMode) << "\n";
 			cout << "\n\n";
 		}
 		if (!perfect) {
@@ -519,8 +1144,21 @@ int main(int argc, char ** argv) {
 		cout << "No solution found.\n";
 	}
 	if (showCount) {
+		cout << "Number of zones: " << zoneCount << "\n";
 		cout << "Number of board states processed: " + to_string(loopCount) + "\n";
 		cout << "Number of moves: " << sequence.size()-1 << "\n";
+		cout << "Peak memory: " << peakMemoryKB() << " KB\n";
+		if (result.symmetries > 0) {
+			cout << "Symmetries: " << result.symmetries << (result.symmetriesGeneral ? " (every automorphism of the graph)" : " (some automorphisms of the graph, and the board's mirrors and rotations)") << "\n";
+			double ratio = result.symmetryConsidered == 0 ? 0 : 100.0 * result.symmetryPruned / result.symmetryConsidered;
+			cout << "Symmetric moves pruned: " << result.symmetryPruned << " of " << result.symmetryConsidered << " (" << ratio << "%)\n";
+		}
+		if (result.memory.size() > 0) {
+			cout << "Memory by structure (live KB, peak KB, allocations):\n";
+			for (auto & use : result.memory) {
+				cout << "\t" << use.name << ": " << use.live / 1024 << ", " << use.peak / 1024 << ", " << use.allocations << "\n";
+			}
+		}
 	}
 	
 	return 0;
@@ -0,0 +1,140 @@
+#! /usr/bin/python3
+
+# Measures how the solver scales with board size, color count and zone count.
+# Generates boards with './kamiSolver -generate=...', solves each one, and records
+# wall time, board states processed and peak memory (max RSS) to a CSV file.
+# If matplotlib is installed, also plots each measurement against zone count.
+# With '--engines', solves each board once per engine and prints how they compare by zone count:
+# this is what '-engine=auto' was calibrated with.
+# designed for linux.
+# usage: ./benchmark.py --sizes 4x4,6x6,8x8 --colors 3,4,5 --kinds uniform,blobby --seeds 3 --timeout 30
+#        ./benchmark.py --sizes 8x8,12x12,16x16 --timeout 20 --engines="-engine=best;-engine=mcts"
+
+import argparse
+import csv
+import subprocess as SP
+import time
+
+def parseArgs():
+    p = argparse.ArgumentParser(description="Scaling benchmark for kamiSolver, on generated boards.")
+    p.add_argument("--sizes", default="4x4,6x6,8x8,10x10", help="comma-separated WxH board sizes")
+    p.add_argument("--colors", default="3,4,5", help="comma-separated color counts")
+    p.add_argument("--kinds", default="uniform,blobby,planted", help="comma-separated board kinds")
+    p.add_argument("--seeds", type=int, default=3, help="boards per combination")
+    p.add_argument("--plant", type=int, default=6, help="moves to plant in planted boards")
+    p.add_argument("--timeout", type=int, default=30, help="seconds allowed per solve")
+    p.add_argument("--args", default="", help="extra solver args, e.g. '-engine=fixed'")
+    p.add_argument("--engines", default="", help="semicolon-separated solver args to compare on each board, "
+                   "e.g. '-engine=best;-engine=fixed -orderMoves'")
+    p.add_argument("--csv", default="bench_output.csv", help="where to write results")
+    p.add_argument("--plot", default="bench_output.png", help="where to write the plot, if matplotlib is available")
+    return p.parse_args()
+
+# Runs the solver on one board, returning (seconds, states, moves, zones, max RSS in KB, timed out).
+def runOne(boardText, args, timeout):
+    cmd = ["./kamiSolver", "-c0", "-auto", "-moves", "-count", "-t=" + str(timeout)] + args
+    start = time.time()
+    proc = SP.Popen(cmd, stdin=SP.PIPE, stdout=SP.PIPE, text=True)
+    proc.stdin.write(boardText + "\nq\n")
+    proc.stdin.close()
+    out = proc.stdout.read()
+    proc.wait()
+    seconds = time.time() - start
+    states = zones = rss = None
+    for line in out.splitlines():
+        if line.startswith("Number of board states processed:"):
+            states = int(line.split(":")[1])
+        elif line.startswith("Number of zones:"):
+            zones = int(line.split(":")[1])
+        elif line.startswith("Peak memory:"):
+            # Reported by the solver itself, since a forked child's max RSS includes its parent's.
+            rss = int(line.split(":")[1].split()[0])
+    moves = sum(1 for line in out.splitlines() if line.startswith("("))
+    timedOut = "# Timed out" in out or "# No solution" in out
+    return seconds, states, moves, zones, rss, timedOut
+
+def generate(kind, size, colors, seed, plant):
+    res = SP.run(("./kamiSolver", "-generate=" + kind, "-size=" + size, "-palette=" + str(colors),
+                  "-seed=" + str(seed), "-plant=" + str(plant)), text=True, capture_output=True, check=True)
+    return res.stdout
+
+# Zone counts are grouped up to each of these, and above the last, when comparing engines.
+bands = (32, 64, 128, 200, 500)
+
+def bandOf(zones):
+    low = 0
+    for high in bands:
+        if zones <= high:
+            return "%d-%d" % (low + 1, high)
+        low = high
+    return ">%d" % bands[-1]
+
+# For each zone band and engine: boards solved, boards left with no solution, moves beyond the
+# fewest any engine found on the same board (summed, over boards it solved), and mean seconds.
+def compare(rows):
+    fewest = {}
+    for r in rows:
+        if r["moves"] > 0:
+            key = (r["size"], r["colors"], r["kind"], r["seed"])
+            fewest[key] = min(fewest.get(key, r["moves"]), r["moves"])
+    print()
+    print("%-9s %-30s %6s %11s %12s %8s" % ("zones", "engine", "boards", "no solution", "extra moves", "seconds"))
+    for band in sorted(set(bandOf(r["zones"]) for r in rows if r["zones"] is not None),
+                       key=lambda b: int(b.lstrip(">").split("-")[0])):
+        for engine in dict.fromkeys(r["engine"] for r in rows):
+            group = [r for r in rows if r["engine"] == engine and r["zones"] is not None and bandOf(r["zones"]) == band]
+            if not group:
+                continue
+            solved = [r for r in group if r["moves"] > 0]
+            extra = sum(r["moves"] - fewest[(r["size"], r["colors"], r["kind"], r["seed"])] for r in solved)
+            seconds = sum(r["seconds"] for r in group) / len(group)
+            print("%-9s %-30s %6d %11d %12d %8.2f" % (band, engine or "(default)", len(group), len(group) - len(solved), extra, seconds))
+
+def plot(rows, path):
+    try:
+        import matplotlib
+        matplotlib.use("Agg")
+        import matplotlib.pyplot as plt
+    except ImportError:
+        print("matplotlib not found; skipping plot.")
+        return
+    fig, axes = plt.subplots(1, 3, figsize=(15, 4))
+    for ax, key, label in zip(axes, ("seconds", "states", "maxRssKB"), ("time (s)", "states processed", "max RSS (KB)")):
+        for kind in sorted(set(r["kind"] for r in rows)):
+            pts = [(r["zones"], r[key]) for r in rows if r["kind"] == kind and r["zones"] is not None]
+            ax.scatter([p[0] for p in pts], [p[1] for p in pts], label=kind, s=12)
+        ax.set_xlabel("zones")
+        ax.set_ylabel(label)
+        ax.set_yscale("log")
+    axes[0].legend()
+    fig.tight_layout()
+    fig.savefig(path)
+    print("Plot stored to " + path)
+
+def main():
+    a = parseArgs()
+    extra = a.args.split()
+    engines = a.engines.split(";") if a.engines else [""]
+    rows = []
+    for size in a.sizes.split(","):
+        for colors in [int(c) for c in a.colors.split(",")]:
+            for kind in a.kinds.split(","):
+                for seed in range(1, a.seeds + 1):
+                    board = generate(kind, size, colors, seed, a.plant)
+                    for engine in engines:
+                        seconds, states, moves, zones, rss, timedOut = runOne(board, extra + engine.split(), a.timeout)
+                        row = {"size": size, "colors": colors, "kind": kind, "seed": seed, "engine": engine,
+                               "zones": zones, "moves": moves, "seconds": round(seconds, 4), "states": states,
+                               "maxRssKB": rss, "timedOut": timedOut}
+                        rows.append(row)
+                        print(", ".join(str(k) + "=" + str(v) for k, v in row.items()), flush=True)
+    with open(a.csv, "w", newline="") as f:
+        w = csv.DictWriter(f, fieldnames=list(rows[0].keys()))
+        w.writeheader()
+        w.writerows(rows)
+    print("Results stored to " + a.csv)
+    if a.engines:
+        compare(rows)
+    plot(rows, a.plot)
+
+main()
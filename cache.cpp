@@ -0,0 +1,280 @@
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "cache.h"
+
+using namespace std;
+typedef struct Graph graph;
+
+// File layout (native byte order):
+// header: "KAMICACH", uint32 version, uint32 entry count, uint64 LRU clock.
+// entry:  uint64 hash, uint64 last use, uint32 flags, uint32 key length, uint32 move count,
+//         int32 key[key length], int32 moves[move count * 2] (zone, canonical color).
+static const char magic[8] = {'K','A','M','I','C','A','C','H'};
+static const uint32_t version = 1;
+static const size_t headerSize = 24;
+static const size_t entryHeaderSize = 28;
+static const uint32_t provenFlag = 1;
+
+// An entry, as held in memory while the file is rewritten.
+struct CacheEntry {
+	uint64_t hash;
+	uint64_t lastUsed;
+	uint32_t flags;
+	vector<int> key;
+	vector<int> moves; // zone, color pairs.
+};
+
+// Reads a value from the mapped file.
+template <typename T>
+T readAt(const unsigned char * p) {
+	T res;
+	memcpy(&res,p,sizeof(T));
+	return res;
+}
+
+template <typename T>
+void writeAt(unsigned char * p, T val) {
+	memcpy(p,&val,sizeof(T));
+}
+
+template <typename T>
+void append(string & out, T val) {
+	out.append(reinterpret_cast<const char *>(&val),sizeof(T));
+}
+
+vector<int> canonicalKey(const graph & g, vector<int> & colorMap) {
+	colorMap.clear();
+	vector<int> key;
+	key.push_back(g.nodeCount);
+	int nextColor = 0;
+	for (int node = 0; node < g.nodeCount; node++) {
+		int c = g.colors[node];
+		if ((int)colorMap.size() <= c) colorMap.resize(c + 1,-1);
+		if (colorMap[c] == -1) colorMap[c] = nextColor++;
+		key.push_back(colorMap[c]);
+	}
+	for (int node = 0; node < g.nodeCount; node++) {
+		auto found = g.adjacent.find(node);
+		vector<int> others;
+		if (found != g.adjacent.end()) others.assign(found->second.begin(),found->second.end());
+		sort(others.begin(),others.end());
+		key.push_back(others.size());
+		key.insert(key.end(),others.begin(),others.end());
+	}
+	return key;
+}
+
+uint64_t hashKey(const vector<int> & key) {
+	uint64_t h = 14695981039346656037ull;
+	for (int val : key) {
+		uint32_t v = val;
+		for (int i = 0; i < 4; i++) {
+			h ^= (v >> (8*i)) & 0xff;
+			h *= 1099511628211ull;
+		}
+	}
+	return h;
+}
+
+SolutionCache::SolutionCache(string path, unsigned int maxEntries) : path(path), maxEntries(maxEntries) {
+	openMap();
+}
+
+SolutionCache::~SolutionCache() {
+	closeMap();
+}
+
+// Maps the cache file, if it exists and is valid.
+void SolutionCache::openMap() {
+	closeMap();
+	fd = open(path.c_str(),O_RDWR);
+	if (fd == -1) return; // No cache yet.
+	struct stat info;
+	if (fstat(fd,&info) != 0 or (size_t)info.st_size < headerSize) {
+		closeMap();
+		return;
+	}
+	dataSize = info.st_size;
+	void * mapped = mmap(nullptr,dataSize,PROT_READ | PROT_WRITE,MAP_SHARED,fd,0);
+	if (mapped == MAP_FAILED) {
+		closeMap();
+		return;
+	}
+	data = static_cast<unsigned char *>(mapped);
+	if (memcmp(data,magic,8) != 0 or readAt<uint32_t>(data + 8) != version) {
+		cerr << "Ignoring cache file '" << path << "': not a solution cache, or from another version.\n";
+		closeMap();
+	}
+}
+
+void SolutionCache::closeMap() {
+	if (data != nullptr) munmap(data,dataSize);
+	if (fd != -1) close(fd);
+	data = nullptr;
+	dataSize = 0;
+	fd = -1;
+}
+
+unsigned int SolutionCache::size() {
+	if (data == nullptr) return 0;
+	return readAt<uint32_t>(data + 12);
+}
+
+bool SolutionCache::lookup(const graph & g, vector<Move> & moves, bool & proven) {
+	if (data == nullptr) return false;
+	vector<int> colorMap;
+	vector<int> key = canonicalKey(g,colorMap);
+	uint64_t hash = hashKey(key);
+	uint32_t count = readAt<uint32_t>(data + 12);
+	size_t pos = headerSize;
+	for (uint32_t i = 0; i < count; i++) {
+		if (pos + entryHeaderSize > dataSize) break; // Truncated file.
+		unsigned char * entry = data + pos;
+		uint32_t keyLen = readAt<uint32_t>(entry + 20);
+		uint32_t moveCount = readAt<uint32_t>(entry + 24);
+		size_t entrySize = entryHeaderSize + 4 * (keyLen + 2 * (size_t)moveCount);
+		if (pos + entrySize > dataSize) break;
+		pos += entrySize;
+		if (readAt<uint64_t>(entry) != hash or keyLen != key.size()) continue;
+		if (memcmp(entry + entryHeaderSize,key.data(),4 * keyLen) != 0) continue;
+		// Found it. Map canonical colors back to this board's colors.
+		vector<int> reverseMap(colorMap.size());
+		for (uint c = 0; c < colorMap.size(); c++) {
+			if (colorMap[c] != -1) reverseMap[colorMap[c]] = c;
+		}
+		moves.clear();
+		unsigned char * movePos = entry + entryHeaderSize + 4 * keyLen;
+		for (uint32_t m = 0; m < moveCount; m++) {
+			Move mv;
+			mv.zone = readAt<int32_t>(movePos + 8*m);
+			int color = readAt<int32_t>(movePos + 8*m + 4);
+			if (color < 0 or (uint)color >= reverseMap.size()) return false; // Corrupt entry.
+			mv.color = reverseMap[color];
+			mv.x = mv.y = -1;
+			moves.push_back(mv);
+		}
+		proven = readAt<uint32_t>(entry + 16) & provenFlag;
+		// Mark as recently used, in place.
+		uint64_t clock = readAt<uint64_t>(data + 16) + 1;
+		writeAt<uint64_t>(data + 16,clock);
+		writeAt<uint64_t>(entry + 8,clock);
+		return true;
+	}
+	return false;
+}
+
+bool SolutionCache::lookup(const graph & g, int minSol, int maxSol, vector<Move> & moves, bool & proven) {
+	if (!lookup(g,moves,proven)) return false;
+	int count = moves.size();
+	return (proven or (minSol > 0 and count <= minSol)) and (maxSol == -1 or count < maxSol);
+}
+
+void SolutionCache::store(const graph & g, const vector<Move> & moves, bool proven) {
+	if (maxEntries == 0) return;
+	// Read back all existing entries.
+	vector<CacheEntry> entries;
+	uint64_t clock = 0;
+	if (data != nullptr) {
+		clock = readAt<uint64_t>(data + 16);
+		uint32_t count = readAt<uint32_t>(data + 12);
+		size_t pos = headerSize;
+		for (uint32_t i = 0; i < count; i++) {
+			if (pos + entryHeaderSize > dataSize) break;
+			unsigned char * p = data + pos;
+			CacheEntry e;
+			e.hash = readAt<uint64_t>(p);
+			e.lastUsed = readAt<uint64_t>(p + 8);
+			e.flags = readAt<uint32_t>(p + 16);
+			uint32_t keyLen = readAt<uint32_t>(p + 20);
+			uint32_t moveCount = readAt<uint32_t>(p + 24);
+			size_t entrySize = entryHeaderSize + 4 * (keyLen + 2 * (size_t)moveCount);
+			if (pos + entrySize > dataSize) break;
+			e.key.resize(keyLen);
+			e.moves.resize(2 * moveCount);
+			memcpy(e.key.data(),p + entryHeaderSize,4 * keyLen);
+			memcpy(e.moves.data(),p + entryHeaderSize + 4 * keyLen,8 * moveCount);
+			entries.push_back(e);
+			pos += entrySize;
+		}
+	}
+	// Build the new entry.
+	CacheEntry e;
+	vector<int> colorMap;
+	e.key = canonicalKey(g,colorMap);
+	e.hash = hashKey(e.key);
+	e.lastUsed = ++clock;
+	e.flags = proven ? provenFlag : 0;
+	for (auto & m : moves) {
+		if (m.color < 0 or (uint)m.color >= colorMap.size() or colorMap[m.color] == -1) return; // Not a color on this board.
+		e.moves.push_back(m.zone);
+		e.moves.push_back(colorMap[m.color]);
+	}
+	// Replace an existing entry, unless it is better.
+	bool replaced = false;
+	for (auto & old : entries) {
+		if (old.hash != e.hash or old.key != e.key) continue;
+		bool oldProven = old.flags & provenFlag;
+		if (oldProven and !proven) return;
+		if (oldProven == proven and old.moves.size() <= e.moves.size()) return;
+		old = e;
+		replaced = true;
+	}
+	if (!replaced) entries.push_back(e);
+	// Evict the least recently used entries.
+	if (entries.size() > maxEntries) {
+		sort(entries.begin(),entries.end(),[](const CacheEntry & a, const CacheEntry & b) {
+			return a.lastUsed > b.lastUsed;
+		});
+		entries.resize(maxEntries);
+	}
+	// Write to a temporary file, then swap it in.
+	string out;
+	out.append(magic,8);
+	append<uint32_t>(out,version);
+	append<uint32_t>(out,entries.size());
+	append<uint64_t>(out,clock);
+	for (auto & entry : entries) {
+		append<uint64_t>(out,entry.hash);
+		append<uint64_t>(out,entry.lastUsed);
+		append<uint32_t>(out,entry.flags);
+		append<uint32_t>(out,entry.key.size());
+		append<uint32_t>(out,entry.moves.size() / 2);
+		out.append(reinterpret_cast<const char *>(entry.key.data()),4 * entry.key.size());
+		out.append(reinterpret_cast<const char *>(entry.moves.data()),4 * entry.moves.size());
+	}
+	// The temporary name is unique, so processes sharing a cache never write into each other's.
+	string tmpPath = path + ".XXXXXX";
+	int fd = mkstemp(&tmpPath[0]);
+	if (fd == -1) {
+		cerr << "Failed to write cache file: " << tmpPath << "\n";
+		return;
+	}
+	fchmod(fd,0644); // mkstemp only lets the owner read it.
+	size_t written = 0;
+	while (written < out.size()) {
+		ssize_t n = write(fd,out.data() + written,out.size() - written);
+		if (n <= 0) break;
+		written += n;
+	}
+	close(fd);
+	if (written < out.size()) {
+		cerr << "Failed to write cache file: " << tmpPath << "\n";
+		unlink(tmpPath.c_str());
+		return;
+	}
+	closeMap();
+	if (rename(tmpPath.c_str(),path.c_str()) != 0) {
+		cerr << "Failed to replace cache file: " << path << "\n";
+		unlink(tmpPath.c_str());
+	}
+	openMap();
+}
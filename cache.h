@@ -0,0 +1,50 @@
+#ifndef Cache_H
+#define Cache_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "solver.h"
+
+// A persistent store of solutions, keyed by the canonical form of a zone graph.
+// The canonical form renumbers colors by order of first appearance, so boards
+// that only differ by which colors are used share an entry.
+// The file is memory-mapped for lookups, and rewritten when an entry is added.
+// Once it holds 'maxEntries' entries, the least recently used ones are dropped.
+class SolutionCache {
+protected:
+	std::string path;
+	unsigned int maxEntries;
+	int fd = -1; // The open cache file, or -1.
+	unsigned char * data = nullptr; // The mapped file, or nullptr.
+	size_t dataSize = 0;
+
+	void openMap();
+	void closeMap();
+
+public:
+	SolutionCache(std::string path, unsigned int maxEntries);
+	~SolutionCache();
+
+	// Finds the stored solution for a graph. Only 'zone' and 'color' are set in 'moves'.
+	// 'proven' says if the solution was proven optimal, rather than just meeting a '-min' hint.
+	bool lookup(const struct Graph & g, std::vector<struct Move> & moves, bool & proven);
+
+	// Same, but only returns solutions that a search with these '-min' and '-max' values could return.
+	// Unproven solutions are only returned if they meet the '-min' hint.
+	bool lookup(const struct Graph & g, int minSol, int maxSol, std::vector<struct Move> & moves, bool & proven);
+
+	// Adds or replaces the solution for a graph. Only 'zone' and 'color' are used from 'moves'.
+	void store(const struct Graph & g, const std::vector<struct Move> & moves, bool proven);
+
+	unsigned int size();
+};
+
+// Builds the canonical key of a graph: node count, relabeled colors, then sorted adjacency lists.
+// 'colorMap' maps each actual color to its canonical color.
+std::vector<int> canonicalKey(const struct Graph & g, std::vector<int> & colorMap);
+
+// FNV-1a over a list of ints.
+uint64_t hashKey(const std::vector<int> & key);
+
+#endif
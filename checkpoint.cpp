@@ -0,0 +1,204 @@
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include "checkpoint.h"
+
+using namespace std;
+typedef vector<int> vInt;
+
+// Identifies the file format. Numbers are stored in the machine's own byte order.
+static const string magic = "KAMICKP1";
+
+// Writes a file, keeping a running FNV-1a hash of everything written.
+class HashedOut {
+	ofstream file;
+	uint64_t hash = 14695981039346656037ull;
+public:
+	HashedOut(const string & name) : file(name,ios::binary) {}
+	void put(const void * data, size_t size) {
+		const unsigned char * bytes = (const unsigned char *)data;
+		for (size_t i = 0; i < size; i++) hash = (hash ^ bytes[i]) * 1099511628211ull;
+		file.write((const char *)data,size);
+	}
+	template <class T> void put(T val) {put(&val,sizeof(val));}
+	void put(const string & s) {put(s.data(),s.size());}
+	// Writes the hash so far, unhashed, and closes the file. False if anything failed to write.
+	bool finish() {
+		file.write((const char *)&hash,sizeof(hash));
+		file.close();
+		return !file.fail();
+	}
+};
+
+// Reads a file written by HashedOut.
+class HashedIn {
+	ifstream file;
+	uint64_t hash = 14695981039346656037ull;
+public:
+	bool ok;
+	HashedIn(const string & name) : file(name,ios::binary) {ok = file.is_open();}
+	void get(void * data, size_t size) {
+		if (!ok) return;
+		ok = static_cast<bool>(file.read((char *)data,size));
+		const unsigned char * bytes = (const unsigned char *)data;
+		for (size_t i = 0; ok and i < size; i++) hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	template <class T> T get() {
+		T val{};
+		get(&val,sizeof(val));
+		return val;
+	}
+	string get(size_t size) {
+		// Grown as it is read, so a corrupt size fails at the end of the file rather than in 'new'.
+		string res;
+		char buffer[65536];
+		while (ok and size > 0) {
+			size_t part = min(size,sizeof(buffer));
+			get(buffer,part);
+			res.append(buffer,part);
+			size -= part;
+		}
+		return res;
+	}
+	// Checks the stored hash against the one read, and that nothing follows it.
+	bool finish() {
+		uint64_t expected = hash;
+		uint64_t stored = 0;
+		if (ok) ok = static_cast<bool>(file.read((char *)&stored,sizeof(stored)));
+		return ok and stored == expected and file.peek() == EOF;
+	}
+};
+
+bool Checkpoint::fits(const vInt & colors) {
+	for (int c : colors) {
+		if (c < 0 or c > 255) return false;
+	}
+	return true;
+}
+
+void Checkpoint::putMoves(string & out, const vector<Move> & moves) const {
+	uint16_t count = moves.size();
+	out.append((const char *)&count,sizeof(count));
+	for (auto & m : moves) {
+		uint32_t zone = m.zone;
+		out.append((const char *)&zone,zoneBytes());
+		out.push_back((char)m.color);
+	}
+}
+
+vector<Move> Checkpoint::getMoves(const string & in, size_t & pos) const {
+	uint16_t count;
+	in.copy((char *)&count,sizeof(count),pos);
+	pos += sizeof(count);
+	vector<Move> res(count);
+	for (auto & m : res) {
+		uint32_t zone = 0;
+		in.copy((char *)&zone,zoneBytes(),pos);
+		pos += zoneBytes();
+		m = {(int)zone,-1,-1,(unsigned char)in[pos++]};
+	}
+	return res;
+}
+
+void Checkpoint::addOpen(const vector<Move> & moves) {
+	putMoves(openData,moves);
+	openPaths++;
+}
+
+void Checkpoint::addSeen(const vInt & coloring, int moveCount) {
+	for (int c : coloring) seenData.push_back((char)c);
+	uint16_t count = moveCount;
+	seenData.append((const char *)&count,sizeof(count));
+	seenStates++;
+}
+
+vector<vector<Move>> Checkpoint::open() const {
+	vector<vector<Move>> res;
+	res.reserve(openPaths);
+	size_t pos = 0;
+	for (size_t i = 0; i < openPaths; i++) res.push_back(getMoves(openData,pos));
+	return res;
+}
+
+void Checkpoint::forEachSeen(function<void(const vInt &, int)> f) const {
+	size_t zones = colors.size();
+	vInt coloring(zones);
+	size_t pos = 0;
+	for (size_t i = 0; i < seenStates; i++) {
+		for (size_t z = 0; z < zones; z++) coloring[z] = (unsigned char)seenData[pos++];
+		uint16_t count;
+		seenData.copy((char *)&count,sizeof(count),pos);
+		pos += sizeof(count);
+		f(coloring,count);
+	}
+}
+
+bool Checkpoint::save(const string & path) const {
+	string temp = path + ".tmp";
+	HashedOut out(temp);
+	out.put(magic);
+	out.put((uint32_t)colors.size());
+	for (int c : colors) out.put((uint8_t)c);
+	out.put((int32_t)maxSol);
+	out.put((uint64_t)iterations);
+	out.put(seconds);
+	string bestData;
+	putMoves(bestData,best);
+	out.put(bestData);
+	out.put((uint64_t)openPaths);
+	out.put((uint64_t)openData.size());
+	out.put(openData);
+	out.put((uint64_t)seenStates);
+	out.put(seenData);
+	if (!out.finish()) return false;
+	return rename(temp.c_str(),path.c_str()) == 0;
+}
+
+bool Checkpoint::load(const string & path, string & error) {
+	HashedIn in(path);
+	if (!in.ok) {
+		error = "can't open file";
+		return false;
+	}
+	if (in.get(magic.size()) != magic) {
+		error = "not a checkpoint";
+		return false;
+	}
+	// Read as a string first, so a corrupt count runs out of file rather than memory.
+	string colorData = in.get(in.get<uint32_t>());
+	colors.assign((const unsigned char *)colorData.data(),(const unsigned char *)colorData.data() + colorData.size());
+	maxSol = in.get<int32_t>();
+	iterations = in.get<uint64_t>();
+	seconds = in.get<double>();
+	uint16_t bestCount = in.get<uint16_t>();
+	string bestData((const char *)&bestCount,sizeof(bestCount));
+	bestData += in.get(bestCount * (zoneBytes() + 1));
+	openPaths = in.get<uint64_t>();
+	openData = in.get(in.get<uint64_t>());
+	seenStates = in.get<uint64_t>();
+	seenData = in.get(seenStates * (colors.size() + 2));
+	if (!in.finish()) {
+		error = "file is truncated or corrupt";
+		return false;
+	}
+	size_t pos = 0;
+	best = getMoves(bestData,pos);
+	return true;
+}
+
+bool CheckpointWriter::write(shared_ptr<Checkpoint> snapshot) {
+	if (busy) return false;
+	if (thread.joinable()) thread.join();
+	busy = true;
+	thread = std::thread([this,snapshot]() {
+		lastFailed = !snapshot->save(path);
+		busy = false;
+	});
+	return true;
+}
+
+void CheckpointWriter::wait() {
+	if (thread.joinable()) thread.join();
+}
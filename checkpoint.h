@@ -0,0 +1,64 @@
+#ifndef Checkpoint_H
+#define Checkpoint_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include "solver.h"
+
+// A snapshot of a best-first search, enough to carry it on later: each open path (as the moves
+// that reach it from the start), the duplicate table, the best solution, and the work done so far.
+// Paths and colorings are kept packed in memory just as they are in the file, one byte per color.
+class Checkpoint {
+	std::string openData; // Per path: a 2 byte move count, then each move's zone and color.
+	std::string seenData; // Per state: a packed coloring, then a 2 byte move count.
+	size_t openPaths = 0;
+	size_t seenStates = 0;
+	int zoneBytes() const {return colors.size() < 65536 ? 2 : 4;}
+	void putMoves(std::string & out, const std::vector<struct Move> & moves) const;
+	std::vector<struct Move> getMoves(const std::string & in, size_t & pos) const;
+public:
+	std::vector<int> colors; // The starting color of each zone. A snapshot only resumes on the same board.
+	int maxSol = -1; // Solutions must be shorter than this. -1 means no cutoff.
+	unsigned long iterations = 0; // Partial paths processed before the snapshot.
+	double seconds = 0; // Time searched before the snapshot.
+	std::vector<struct Move> best; // The best solution so far, by zone. Empty if none.
+
+	// Colors must be below 256, and move counts below 65536.
+	static bool fits(const std::vector<int> & colors);
+
+	void addOpen(const std::vector<struct Move> & moves);
+	void addSeen(const std::vector<int> & coloring, int moveCount);
+	size_t openCount() const {return openPaths;}
+	size_t seenCount() const {return seenStates;}
+	// The open paths, in the order they were added.
+	std::vector<std::vector<struct Move>> open() const;
+	void forEachSeen(std::function<void(const std::vector<int> &, int)> f) const;
+
+	// Writes to 'path' by way of a temporary file, so a crash midway leaves the last snapshot intact.
+	bool save(const std::string & path) const;
+	// Reads a snapshot. On failure, 'error' says why.
+	bool load(const std::string & path, std::string & error);
+};
+
+// Saves snapshots on a thread of its own, so the search only stops to pack them.
+class CheckpointWriter {
+	std::string path;
+	std::thread thread;
+	std::atomic<bool> busy{false};
+	std::atomic<bool> lastFailed{false};
+public:
+	CheckpointWriter(std::string path) : path(path) {}
+	~CheckpointWriter() {wait();}
+	// Starts saving 'snapshot'. Returns false, and skips it, if the last one is still being saved.
+	bool write(std::shared_ptr<Checkpoint> snapshot);
+	// Waits until the last snapshot is saved.
+	void wait();
+	// True if the last snapshot finished saving, and couldn't be.
+	bool failed() const {return !busy and lastFailed;}
+};
+
+#endif
@@ -0,0 +1,255 @@
+#ifndef FixedSearch_H
+#define FixedSearch_H
+
+#include <vector>
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <algorithm>
+#include "solver.h"
+
+// A depth-first search specialized for boards with at most N zones and C colors.
+// Every container is a fixed-size array or bitset, and color counts are kept per color.
+// Nodes keep their original zone numbers; merged nodes simply stop being 'alive'.
+// There is a single state: each move is made in place, and undone on the way back up,
+// so a move only touches the nodes it merges and their neighbors.
+template <int N, int C>
+class FixedSearch {
+protected:
+	// What a move changed, so it can be undone.
+	struct Undo {
+		int node;
+		unsigned char oldColor;
+		std::bitset<N> merged; // The nodes merged into 'node'.
+		std::bitset<N> oldAdj; // The adjacency of 'node' before the move.
+	};
+
+	struct State {
+		std::bitset<N> alive; // Nodes not yet merged into another node.
+		std::array<std::bitset<N>,N> adj; // Adjacency, between live nodes only. Dead nodes keep theirs, for undo.
+		std::array<std::bitset<N>,C> byColor; // The live nodes of each color.
+		std::array<unsigned char,N> color;
+		std::array<int,C> counts{}; // The number of live nodes of each color.
+		int colors = 0; // The number of colors with live nodes.
+		int live = 0; // The number of live nodes.
+		std::vector<Undo> undos; // One entry for each move made, most recent last.
+
+		int colorCount() const {return colors;}
+
+		void addNode(int node, int nColor) {
+			alive.set(node);
+			color[node] = nColor;
+			byColor[nColor].set(node);
+			if (counts[nColor]++ == 0) colors++;
+			live++;
+		}
+
+		// Recolors 'node', merging it with same-colored neighbors.
+		void apply(int node, int nColor) {
+			undos.push_back({node,color[node],adj[node] & byColor[nColor],adj[node]});
+			const std::bitset<N> & merged = undos.back().merged;
+			byColor[color[node]].reset(node);
+			if (--counts[color[node]] == 0) colors--;
+			for (int u = merged._Find_first(); u < N; u = merged._Find_next(u)) {
+				adj[node] |= adj[u];
+				alive.reset(u);
+				byColor[nColor].reset(u);
+				for (int w = adj[u]._Find_first(); w < N; w = adj[u]._Find_next(w)) {
+					adj[w].reset(u);
+					adj[w].set(node);
+				}
+			}
+			int mergedCount = merged.count();
+			counts[nColor] -= mergedCount;
+			live -= mergedCount;
+			adj[node] &= ~merged;
+			adj[node].reset(node);
+			color[node] = nColor;
+			byColor[nColor].set(node);
+			counts[nColor]++;
+		}
+
+		// Reverts the most recent 'apply'.
+		void undo() {
+			Undo & u = undos.back();
+			int node = u.node;
+			int nColor = color[node];
+			byColor[nColor].reset(node);
+			counts[nColor]--;
+			for (int m = u.merged._Find_first(); m < N; m = u.merged._Find_next(m)) {
+				for (int w = adj[m]._Find_first(); w < N; w = adj[m]._Find_next(w)) {
+					adj[w].set(m);
+					if (!u.oldAdj[w]) adj[w].reset(node);
+				}
+				alive.set(m);
+				byColor[nColor].set(m);
+			}
+			int mergedCount = u.merged.count();
+			counts[nColor] += mergedCount;
+			live += mergedCount;
+			adj[node] = u.oldAdj;
+			color[node] = u.oldColor;
+			byColor[u.oldColor].set(node);
+			if (counts[u.oldColor]++ == 0) colors++;
+			undos.pop_back();
+		}
+
+		// The eccentricity of a node, by breadth-first search over bitsets.
+		int eccentricity(int node) const {
+			std::bitset<N> seen;
+			std::bitset<N> frontier;
+			frontier.set(node);
+			seen.set(node);
+			int dist = 0;
+			while (true) {
+				std::bitset<N> next;
+				for (int u = frontier._Find_first(); u < N; u = frontier._Find_next(u)) next |= adj[u];
+				next &= ~seen;
+				if (next.none()) return dist;
+				seen |= next;
+				frontier = next;
+				dist++;
+			}
+		}
+	};
+
+	// A move, and what it is ordered by when 'orderMoves' is set.
+	struct Candidate {
+		int node;
+		int color;
+		int rank; // 0 for the killer move, 1 to recolor the last node again, 2 for its neighbors, 3 otherwise.
+		unsigned long history;
+		int eccentricity;
+	};
+
+	State state;
+	std::vector<std::pair<int,int>> path; // (node, color) moves on the current branch.
+	std::vector<std::vector<Candidate>> moveLists; // The moves tried at each depth, when ordering them.
+	std::vector<unsigned long> history; // By node and color: how deep the moves' subtrees have gone.
+	std::vector<std::pair<int,int>> killers; // By depth: the move whose subtree went deepest, last time there.
+	size_t reached = 0; // The deepest point of the current subtree.
+	std::chrono::steady_clock::time_point start;
+	SolveOptions & options;
+	bool stopped = false;
+
+public:
+	std::vector<std::pair<int,int>> solution;
+	unsigned long iterations = 0;
+
+	FixedSearch(SolveOptions & options) : options(options) {}
+
+	// A lower bound on the moves left: every color but one must go,
+	// and each move shrinks the diameter by at most 2.
+	static int lowerBound(const State & s, int lastNode) {
+		int colors = s.colorCount() - 1;
+		int ecc = (s.eccentricity(lastNode) + 1) / 2;
+		return colors > ecc ? colors : ecc;
+	}
+
+	// Searches for a solution using at most 'limit' more moves from the current state.
+	// Moves are tried one at a time, each made and then undone in 'state'.
+	bool dfs(int limit, int lastNode) {
+		State & s = state;
+		iterations++;
+		if (path.size() > reached) reached = path.size();
+		if (s.live == 1) return true;
+		if (limit <= 0) return false;
+		if ((iterations & 1023) == 0) {
+			if (options.maxNodes != 0 and iterations > options.maxNodes) stopped = true;
+			if (options.maxTime != 0 and std::chrono::steady_clock::now() - start > std::chrono::seconds(options.maxTime)) stopped = true;
+		}
+		if (stopped) return false;
+		if (lowerBound(s,lastNode) > limit) return false;
+		// With exactly enough moves for the colors, every move must remove a color.
+		bool colorCapped = s.colorCount() - 1 == limit;
+		if (options.orderMoves) return dfsOrdered(limit,lastNode,colorCapped);
+		for (int node = s.alive._Find_first(); node < N; node = s.alive._Find_next(node)) {
+			if (colorCapped and s.counts[s.color[node]] != 1) continue;
+			for (int c = 0; c < C; c++) {
+				if ((s.adj[node] & s.byColor[c]).none()) continue;
+				s.apply(node,c);
+				path.push_back({node,c});
+				if (dfs(limit - 1,node)) return true;
+				path.pop_back();
+				s.undo();
+				if (stopped) return false;
+			}
+		}
+		return false;
+	}
+
+	// Like the loop in 'dfs', but tries the killer move for this depth first, then moves of the
+	// most central nodes (only far from the leaves, where it pays for itself), then moves that
+	// grow or touch the last node recolored, then moves with the most history.
+	// Only the final iteration gets faster, since the others search everything anyway.
+	bool dfsOrdered(int limit, int lastNode, bool colorCapped) {
+		State & s = state;
+		size_t depth = path.size();
+		std::vector<Candidate> & moves = moveLists[depth];
+		moves.clear();
+		for (int node = s.alive._Find_first(); node < N; node = s.alive._Find_next(node)) {
+			if (colorCapped and s.counts[s.color[node]] != 1) continue;
+			int rank = 3;
+			if (depth > 0 and node == lastNode) rank = 1;
+			else if (depth > 0 and s.adj[lastNode][node]) rank = 2;
+			int ecc = limit >= 3 ? s.eccentricity(node) : 0;
+			for (int c = 0; c < C; c++) {
+				if ((s.adj[node] & s.byColor[c]).none()) continue;
+				bool killer = killers[depth].first == node and killers[depth].second == c;
+				moves.push_back({node,c,killer ? 0 : rank,history[node * C + c],ecc});
+			}
+		}
+		std::sort(moves.begin(),moves.end(),[](const Candidate & a, const Candidate & b) {
+			if ((a.rank == 0) != (b.rank == 0)) return a.rank == 0;
+			if (a.eccentricity != b.eccentricity) return a.eccentricity < b.eccentricity;
+			if (a.rank != b.rank) return a.rank < b.rank;
+			return a.history > b.history;
+		});
+		size_t deepest = 0;
+		for (auto & m : moves) {
+			size_t outer = reached;
+			reached = depth + 1;
+			s.apply(m.node,m.color);
+			path.push_back({m.node,m.color});
+			if (dfs(limit - 1,m.node)) return true;
+			path.pop_back();
+			s.undo();
+			size_t gained = reached - depth;
+			history[m.node * C + m.color] += gained * gained;
+			if (reached > deepest) {
+				deepest = reached;
+				killers[depth] = {m.node,m.color};
+			}
+			if (reached < outer) reached = outer;
+			if (stopped) return false;
+		}
+		return false;
+	}
+
+	// Iterative deepening, from the lower bound up to (but excluding) 'maxSol'.
+	// The first solution found is optimal. Returns false if stopped by a time or node limit.
+	bool run(const struct Graph & g) {
+		start = std::chrono::steady_clock::now();
+		for (int node = 0; node < g.nodeCount; node++) {
+			state.addNode(node,g.colors[node]);
+			for (int other : g.adjacent.at(node)) state.adj[node].set(other);
+		}
+		history.assign(g.nodeCount * C,0);
+		int maxSol = options.maxSol;
+		int first = lowerBound(state,0);
+		for (int limit = first; maxSol == -1 or limit < maxSol; limit++) {
+			state.undos.reserve(limit);
+			moveLists.resize(limit + 1);
+			killers.resize(limit + 1,{-1,-1});
+			path.clear();
+			if (dfs(limit,0)) {
+				solution = path;
+				return true;
+			}
+			if (stopped) return false;
+		}
+		return true;
+	}
+};
+
+#endif
@@ -0,0 +1,116 @@
+#include <vector>
+#include <random>
+#include <queue>
+#include <algorithm>
+#include "generator.h"
+
+using namespace std;
+typedef vector<vector<int>> board;
+
+// The in-bounds neighbors of a cell.
+vector<pair<int,int>> neighbors(int x, int y, int width, int height) {
+	vector<pair<int,int>> res;
+	if (x > 0) res.push_back({x-1,y});
+	if (y > 0) res.push_back({x,y-1});
+	if (x < width - 1) res.push_back({x+1,y});
+	if (y < height - 1) res.push_back({x,y+1});
+	return res;
+}
+
+// Grows clusters from random seeds, one random frontier cell at a time.
+board blobby(int width, int height, int colors, mt19937 & rng) {
+	board res(height,vector<int>(width,-1));
+	// Roughly one cluster per 6 cells.
+	int seeds = max(1,width * height / 6);
+	vector<pair<int,int>> frontier;
+	for (int i = 0; i < seeds; i++) {
+		int x = rng() % width;
+		int y = rng() % height;
+		if (res[y][x] != -1) continue;
+		res[y][x] = rng() % colors;
+		frontier.push_back({x,y});
+	}
+	while (frontier.size() > 0) {
+		int pick = rng() % frontier.size();
+		auto cell = frontier[pick];
+		bool grew = false;
+		for (auto n : neighbors(cell.first,cell.second,width,height)) {
+			if (res[n.second][n.first] != -1) continue;
+			res[n.second][n.first] = res[cell.second][cell.first];
+			frontier.push_back(n);
+			grew = true;
+			break; // One cell at a time keeps the clusters irregular.
+		}
+		if (!grew) {
+			frontier[pick] = frontier.back();
+			frontier.pop_back();
+		}
+	}
+	return res;
+}
+
+// Starts from a single color, then undoes 'moves' random moves.
+// Undoing a move picks a connected patch of one color, and paints it a color that no
+// neighboring cell has. Clicking the patch and choosing its old color then redoes the move,
+// so the board can be solved in at most 'moves' moves.
+board planted(int width, int height, int colors, int & moves, mt19937 & rng) {
+	board res(height,vector<int>(width,rng() % colors));
+	int done = 0;
+	for (int attempt = 0; done < moves and attempt < moves * 100; attempt++) {
+		int x = rng() % width;
+		int y = rng() % height;
+		int color = res[y][x];
+		// Grow a random patch within the cell's zone.
+		int target = 1 + rng() % max(1,width * height / 4);
+		vector<vector<bool>> inPatch(height,vector<bool>(width,false));
+		vector<pair<int,int>> patch = {{x,y}};
+		vector<pair<int,int>> frontier = {{x,y}};
+		inPatch[y][x] = true;
+		while ((int)patch.size() < target and frontier.size() > 0) {
+			int pick = rng() % frontier.size();
+			auto cell = frontier[pick];
+			vector<pair<int,int>> options;
+			for (auto n : neighbors(cell.first,cell.second,width,height)) {
+				if (!inPatch[n.second][n.first] and res[n.second][n.first] == color) options.push_back(n);
+			}
+			if (options.size() == 0) {
+				frontier[pick] = frontier.back();
+				frontier.pop_back();
+				continue;
+			}
+			auto n = options[rng() % options.size()];
+			inPatch[n.second][n.first] = true;
+			patch.push_back(n);
+			frontier.push_back(n);
+		}
+		// Find the colors touching the patch.
+		vector<bool> touching(colors,false);
+		touching[color] = true;
+		for (auto cell : patch) {
+			for (auto n : neighbors(cell.first,cell.second,width,height)) {
+				if (!inPatch[n.second][n.first]) touching[res[n.second][n.first]] = true;
+			}
+		}
+		vector<int> free;
+		for (int c = 0; c < colors; c++) {
+			if (!touching[c]) free.push_back(c);
+		}
+		if (free.size() == 0) continue;
+		int newColor = free[rng() % free.size()];
+		for (auto cell : patch) res[cell.second][cell.first] = newColor;
+		done++;
+	}
+	moves = done;
+	return res;
+}
+
+board generateBoard(BoardKind kind, int width, int height, int colors, unsigned int seed, int & plantedMoves) {
+	mt19937 rng(seed);
+	if (kind == BoardKind::Blobby) return blobby(width,height,colors,rng);
+	if (kind == BoardKind::Planted) return planted(width,height,colors,plantedMoves,rng);
+	board res(height,vector<int>(width));
+	for (auto & row : res) {
+		for (auto & val : row) val = rng() % colors;
+	}
+	return res;
+}
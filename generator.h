@@ -0,0 +1,19 @@
+#ifndef Generator_H
+#define Generator_H
+
+#include <vector>
+#include <string>
+
+// Kinds of random board.
+enum class BoardKind {
+	Uniform, // Every cell is an independent random color.
+	Blobby, // Random seeds grown outwards into irregular clusters.
+	Planted, // Built backwards from a solved board, so it is solvable in at most 'plantedMoves' moves.
+};
+
+// Generates a random board of colors 0 to colors-1. The same seed always gives the same board.
+// For planted boards, 'plantedMoves' is updated to the number of moves actually planted
+// (fewer than asked for, if the board ran out of room).
+std::vector<std::vector<int>> generateBoard(BoardKind kind, int width, int height, int colors, unsigned int seed, int & plantedMoves);
+
+#endif
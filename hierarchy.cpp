@@ -0,0 +1,194 @@
+#include <vector>
+#include <map>
+#include <queue>
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include "hierarchy.h"
+
+using namespace std;
+typedef vector<int> vInt;
+typedef struct Graph graph;
+typedef vector<vector<int>> board;
+
+// Cuts a graph into connected regions of at most 'size' nodes, grown breadth-first
+// from the lowest node not yet taken. Returns the region of each node.
+static vInt partition(graph & g, int size, int & regionCount) {
+	vInt region(g.nodeCount,-1);
+	regionCount = 0;
+	for (int seed = 0; seed < g.nodeCount; seed++) {
+		if (region[seed] != -1) continue;
+		int r = regionCount++;
+		int taken = 0;
+		queue<int> toVisit;
+		toVisit.push(seed);
+		region[seed] = r;
+		while (toVisit.size() > 0 and taken < size) {
+			int node = toVisit.front();
+			toVisit.pop();
+			taken++;
+			for (int other : g.adjacent[node]) {
+				if (region[other] != -1 or taken + (int)toVisit.size() >= size) continue;
+				region[other] = r;
+				toVisit.push(other);
+			}
+		}
+	}
+	return region;
+}
+
+// The subgraph of the nodes in 'members', renumbered from 0 in that order.
+static graph induced(graph & g, const vInt & members) {
+	map<int,int> local;
+	for (int i = 0; i < (int)members.size(); i++) local[members[i]] = i;
+	graph res;
+	res.nodeCount = members.size();
+	for (int i = 0; i < res.nodeCount; i++) {
+		res.colors.push_back(g.colors[members[i]]);
+		res.adjacent[i];
+		for (int other : g.adjacent[members[i]]) {
+			auto found = local.find(other);
+			if (found != local.end()) res.adjacent[i].insert(found->second);
+		}
+	}
+	return res;
+}
+
+// The first cell (in reading order) of each zone.
+static vector<pair<int,int>> firstCells(board & zones, int zoneCount) {
+	vector<pair<int,int>> res(zoneCount,{-1,-1});
+	for (int y = 0; y < (int)zones.size(); y++) {
+		for (int x = 0; x < (int)zones[y].size(); x++) {
+			if (res[zones[y][x]].first == -1) res[zones[y][x]] = {x,y};
+		}
+	}
+	return res;
+}
+
+// Plays a move on the board, and records it if it changed anything.
+static void play(board & cells, vector<Move> & moves, int x, int y, int color) {
+	if (applyMove(cells,x,y,color) == 0) return;
+	moves.push_back({-1,x,y,color});
+}
+
+// A move that is sure to merge zones: the zone with the most neighbors, recolored to
+// the most common color among them.
+static void greedyMove(graph & g, vector<pair<int,int>> & cellOf, board & cells, vector<Move> & moves) {
+	int best = 0;
+	for (int node = 1; node < g.nodeCount; node++) {
+		if (g.adjacent[node].size() > g.adjacent[best].size()) best = node;
+	}
+	map<int,int> colorCounts;
+	for (int other : g.adjacent[best]) colorCounts[g.colors[other]]++;
+	int color = -1;
+	for (auto & entry : colorCounts) {
+		if (color == -1 or entry.second > colorCounts[color]) color = entry.first;
+	}
+	play(cells,moves,cellOf[best].first,cellOf[best].second,color);
+}
+
+// True if the moves, played in order from 'cells', leave it all one color.
+static bool solves(board cells, const vector<Move> & moves) {
+	for (auto & m : moves) applyMove(cells,m.x,m.y,m.color);
+	for (auto & row : cells) {
+		for (int val : row) {
+			if (val != cells[0][0]) return false;
+		}
+	}
+	return true;
+}
+
+// Drops single moves the solution still works without, while the work allowed lasts.
+// Each try replays everything, so boards with many cells and moves get fewer tries.
+static void dropUnneeded(board & cells, vector<Move> & moves) {
+	long cellCount = cells.size() * cells[0].size();
+	long budget = 200000000; // Cells flooded, roughly, over all the tries.
+	for (int i = moves.size() - 1; i >= 0; i--) {
+		budget -= cellCount * moves.size();
+		if (budget < 0) return;
+		vector<Move> fewer = moves;
+		fewer.erase(fewer.begin() + i);
+		if (solves(cells,fewer)) moves.swap(fewer);
+	}
+}
+
+bool solveHierarchical(graph & startingPoint, board & zoneMap, SolveOptions & options, SolveResult & result) {
+	int regionSize = max(2,(int)options.regionSize);
+	// Small boards are solved whole.
+	if (startingPoint.nodeCount <= regionSize) {
+		SolveOptions whole = options;
+		whole.engine = Engine::BestFirst;
+		return solve(startingPoint,zoneMap,whole,result);
+	}
+	auto start = chrono::steady_clock::now();
+	bool fullSearch = true;
+	board cells = zoneMap;
+	for (auto & row : cells) {
+		for (auto & val : row) val = startingPoint.colors[val];
+	}
+	board original = cells;
+	vector<Move> moves;
+	unsigned long iterations = 0;
+	// Each region is solved with the default engine, on a budget.
+	SolveOptions regional;
+	regional.strategy = Strategy::Lean;
+	regional.quiet = true;
+	regional.maxNodes = options.regionNodes;
+	int lastCount = startingPoint.nodeCount + 1;
+	while (true) {
+		int zoneCount;
+		vInt zoneColors;
+		board zones = genZones(cells,zoneCount,zoneColors);
+		if (zoneCount == 1) break;
+		graph g = genGraph(zones,zoneCount,zoneColors);
+		vector<pair<int,int>> cellOf = firstCells(zones,zoneCount);
+		bool outOfTime = options.maxTime != 0 and chrono::steady_clock::now() - start > chrono::seconds(options.maxTime);
+		if (outOfTime) fullSearch = false;
+		// Out of time, finish quickly so there is still a solution to give.
+		// And if the last pass gained nothing, make sure this one does.
+		bool stuck = zoneCount >= lastCount;
+		lastCount = zoneCount;
+		if (outOfTime or stuck) {
+			greedyMove(g,cellOf,cells,moves);
+			continue;
+		}
+		int regionCount = 1;
+		vInt region(zoneCount,0);
+		if (zoneCount > regionSize) region = partition(g,regionSize,regionCount);
+		vector<vInt> members(regionCount);
+		for (int zone = 0; zone < zoneCount; zone++) members[region[zone]].push_back(zone);
+		for (auto & m : members) {
+			if (m.size() == 1) continue;
+			graph sub = induced(g,m);
+			board noMap;
+			SolveResult part;
+			solve(sub,noMap,regional,part);
+			iterations += part.iterations;
+			// The regions' moves are played on the real board, where a recolored zone can also
+			// merge with zones outside its region. The next pass works from wherever that leads.
+			for (auto & move : part.moves) {
+				pair<int,int> cell = cellOf[m[move.zone]];
+				play(cells,moves,cell.first,cell.second,move.color);
+			}
+		}
+	}
+	dropUnneeded(original,moves);
+
+	// Fill in the results by replaying the moves on the board.
+	// 'graphs' is left empty: for the boards this is meant for, a graph per move would take gigabytes.
+	result.iterations = iterations;
+	result.complete = fullSearch;
+	result.proven = false;
+	result.boards = {original};
+	result.graphs = {};
+	result.moves = {};
+	cells = original;
+	for (auto & m : moves) {
+		result.moves.push_back({zoneMap[m.y][m.x],m.x,m.y,m.color});
+		applyMove(cells,m.x,m.y,m.color);
+		result.boards.push_back(cells);
+	}
+	if (options.showCount) cout << "Found new solution: " << moves.size() << " moves.\n";
+	if (options.onImprove) options.onImprove(result.moves);
+	return fullSearch;
+}
@@ -0,0 +1,16 @@
+#ifndef Hierarchy_H
+#define Hierarchy_H
+
+#include <vector>
+#include "solver.h"
+
+// Solves boards too large to search whole, for a quick upper bound rather than an optimum.
+// The zone graph is cut into connected regions of at most 'options.regionSize' zones, and each
+// region is solved on its own (made one color) with the default engine. Their moves are then
+// played on the real board, which gives a much smaller zone graph to cut up again, until what
+// is left is small enough to solve whole. Last, moves that turn out to be unneeded are dropped.
+// Boards of at most 'regionSize' zones are just solved with the default engine.
+// Fills 'result' like 'solve'; 'result.proven' is only set if the board was solved whole.
+bool solveHierarchical(struct Graph & startingPoint, std::vector<std::vector<int>> & zoneMap, SolveOptions & options, SolveResult & result);
+
+#endif
@@ -0,0 +1,90 @@
+#include <vector>
+#include <string>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include "memstats.h"
+
+using namespace std;
+
+#ifdef MEMSTATS
+
+static const int tagCount = (int)MemTag::Count;
+static atomic<long> live[tagCount];
+static atomic<long> peak[tagCount];
+static atomic<unsigned long> allocations[tagCount];
+static thread_local int currentTag = 0;
+
+// Each allocation is preceded by a header saying its size and tag.
+// 16 bytes, so the memory after it keeps malloc's alignment.
+struct alignas(16) AllocHeader {
+	size_t size;
+	int tag;
+};
+
+static void * allocate(size_t size) {
+	AllocHeader * h = (AllocHeader *)malloc(sizeof(AllocHeader) + size);
+	if (h == nullptr) throw bad_alloc();
+	h->size = size;
+	h->tag = currentTag;
+	long now = live[h->tag].fetch_add(size,memory_order_relaxed) + size;
+	long top = peak[h->tag].load(memory_order_relaxed);
+	while (now > top and !peak[h->tag].compare_exchange_weak(top,now,memory_order_relaxed)) {}
+	allocations[h->tag].fetch_add(1,memory_order_relaxed);
+	return h + 1;
+}
+
+static void release(void * p) {
+	if (p == nullptr) return;
+	AllocHeader * h = (AllocHeader *)p - 1;
+	live[h->tag].fetch_sub(h->size,memory_order_relaxed);
+	free(h);
+}
+
+void * operator new(size_t size) {return allocate(size);}
+void * operator new[](size_t size) {return allocate(size);}
+void * operator new(size_t size, const nothrow_t &) noexcept {
+	try {return allocate(size);} catch (...) {return nullptr;}
+}
+void * operator new[](size_t size, const nothrow_t &) noexcept {
+	try {return allocate(size);} catch (...) {return nullptr;}
+}
+void operator delete(void * p) noexcept {release(p);}
+void operator delete[](void * p) noexcept {release(p);}
+void operator delete(void * p, size_t) noexcept {release(p);}
+void operator delete[](void * p, size_t) noexcept {release(p);}
+void operator delete(void * p, const nothrow_t &) noexcept {release(p);}
+void operator delete[](void * p, const nothrow_t &) noexcept {release(p);}
+
+MemScope::MemScope(MemTag tag) : saved((MemTag)currentTag) {
+	currentTag = (int)tag;
+}
+
+MemScope::~MemScope() {
+	currentTag = (int)saved;
+}
+
+vector<MemoryUse> memoryUse() {
+	static const char * names[tagCount] = {"other", "paths", "graph history", "distances", "dedup table"};
+	vector<MemoryUse> res;
+	for (int i = 0; i < tagCount; i++) {
+		MemoryUse use;
+		use.name = names[i];
+		use.live = live[i];
+		use.peak = peak[i];
+		use.allocations = allocations[i];
+		res.push_back(use);
+	}
+	return res;
+}
+
+void resetMemoryPeaks() {
+	for (int i = 0; i < tagCount; i++) peak[i] = live[i].load();
+}
+
+#else
+
+vector<MemoryUse> memoryUse() {return {};}
+void resetMemoryPeaks() {}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef Memstats_H
+#define Memstats_H
+
+#include <string>
+#include <vector>
+
+// Memory accounting per solver data structure.
+// Only compiled in with 'make MEMSTATS=1', since it adds a small header to every allocation.
+// Otherwise 'MemScope' does nothing, and 'memoryUse' returns nothing.
+
+// The structures memory is charged to.
+enum class MemTag {
+	Other, // Anything not inside a MemScope.
+	Paths, // Path copies: their graphs, zone mappings and color counts.
+	GraphHistory, // The graph kept for each move in a Path's history.
+	Distances, // DistTracker matrices.
+	Dedup, // The duplicate detection table's keys and entries.
+	Count, // Not a tag; the number of tags.
+};
+
+// Memory charged to one tag.
+struct MemoryUse {
+	std::string name;
+	long live = 0; // Bytes allocated and not yet freed.
+	long peak = 0; // Most bytes live at once, since the last 'resetMemoryPeaks'.
+	unsigned long allocations = 0; // Allocations made, ever.
+};
+
+// While it exists, allocations on this thread are charged to 'tag'.
+// Memory is always credited back to the tag it was charged to, whichever scope frees it.
+class MemScope {
+#ifdef MEMSTATS
+	MemTag saved;
+public:
+	MemScope(MemTag tag);
+	~MemScope();
+#else
+public:
+	MemScope(MemTag) {}
+#endif
+};
+
+// The current use of every tag. Empty if memory accounting isn't compiled in.
+std::vector<MemoryUse> memoryUse();
+
+// Starts each tag's peak again from its current live bytes.
+void resetMemoryPeaks();
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef PackedColoring_H
+#define PackedColoring_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// The color of each original zone, packed into 64-bit words: 4 bits a zone for up to 16 colors,
+// 6 bits for up to 64, and 8, 16 or 32 beyond that. A zone never straddles two words.
+// Paths keep one per move in their history, and the duplicate tables use them as keys,
+// so they are compared and hashed a word at a time rather than a zone at a time.
+// Only colorings of the same board are compared, so they always share a width.
+class PackedColoring {
+	std::vector<uint64_t> words;
+	uint32_t zones = 0;
+	uint8_t bits = 4;
+	uint8_t perWord = 16; // Zones in each word.
+	uint64_t mask() const {return (uint64_t(1) << bits) - 1;}
+public:
+	// The fewest bits a zone may take, for colors below 'colorLimit'.
+	static int bitsFor(int colorLimit) {
+		for (int b : {4,6,8,16}) {
+			if (colorLimit <= (1 << b)) return b;
+		}
+		return 32;
+	}
+
+	PackedColoring() {}
+	// Every zone starts as color 0.
+	PackedColoring(int zones, int bits) : words((zones + 64 / bits - 1) / (64 / bits),0), zones(zones), bits(bits), perWord(64 / bits) {}
+	PackedColoring(const std::vector<int> & colors, int bits) : PackedColoring(colors.size(),bits) {
+		for (uint32_t zone = 0; zone < zones; zone++) set(zone,colors[zone]);
+	}
+
+	// Only for zones still color 0, as when filling in a new coloring.
+	void set(int zone, int color) {words[zone / perWord] |= (uint64_t)color << (zone % perWord * bits);}
+
+	int size() const {return zones;}
+	int operator[](int zone) const {return (words[zone / perWord] >> (zone % perWord * bits)) & mask();}
+
+	std::vector<int> unpack() const {
+		std::vector<int> res(zones);
+		for (uint32_t zone = 0; zone < zones; zone++) res[zone] = (*this)[zone];
+		return res;
+	}
+
+	bool operator==(const PackedColoring & other) const {return words == other.words;}
+	bool operator!=(const PackedColoring & other) const {return words != other.words;}
+	// Orders by word, not by zone. Only good for keeping colorings in a map.
+	bool operator<(const PackedColoring & other) const {return words < other.words;}
+
+	size_t hash() const {
+		uint64_t h = 14695981039346656037ull; // FNV-1a, a word at a time, then mixed.
+		for (uint64_t w : words) h = (h ^ w) * 1099511628211ull;
+		return h ^ (h >> 29);
+	}
+};
+
+struct PackedColoringHash {
+	size_t operator()(const PackedColoring & c) const {return c.hash();}
+};
+
+#endif
@@ -0,0 +1,216 @@
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <filesystem>
+#include "regress.h"
+
+using namespace std;
+typedef struct Graph graph;
+typedef vector<vector<int>> board;
+
+// Reads a level file: rows of digits, '#' comments, and '-min=' and '-max=' lines.
+// Returns false if the file can't be read as a board.
+bool readLevel(string path, board & b, int & minSol, int & maxSol) {
+	ifstream file(path);
+	if (!file.is_open()) return false;
+	b.clear();
+	minSol = 0;
+	maxSol = -1;
+	string line;
+	while (getline(file,line)) {
+		if (line.rfind("-min=",0) == 0) {
+			minSol = stoi(line.substr(5));
+			continue;
+		}
+		if (line.rfind("-max=",0) == 0) {
+			maxSol = stoi(line.substr(5)) + 1; // Exclusive, as with '-max='.
+			continue;
+		}
+		vector<int> row;
+		for (char c : line) {
+			if (c == '#') break;
+			if (c == ' ' or c == '\t' or c == '\r') continue;
+			if (not (c >= '0' and c <= '9')) return false;
+			row.push_back(c - '0');
+		}
+		if (row.size() == 0) continue;
+		if (b.size() > 0 and row.size() != b[0].size()) return false;
+		b.push_back(row);
+	}
+	return b.size() > 0;
+}
+
+// The number of moves in a recorded solution file, or -1 if there is none.
+// Counts the boards after the first (by their top borders, or by blocks of rows without borders).
+int recordedMoves(string path) {
+	ifstream file(path);
+	if (!file.is_open()) return -1;
+	string line;
+	int borders = 0;
+	int blocks = 0;
+	bool started = false; // Boards start after the "...:" line.
+	bool inBlock = false;
+	while (getline(file,line)) {
+		if (!started) {
+			if (line.size() > 0 and line.back() == ':') started = true;
+			continue;
+		}
+		if (line.rfind("┌",0) == 0) borders++;
+		bool digits = line.size() > 0 and line[0] >= '0' and line[0] <= '9';
+		if (digits and !inBlock) blocks++;
+		inBlock = digits;
+	}
+	int boards = borders > 0 ? borders : blocks;
+	return boards - 1;
+}
+
+// Replays solver moves on the board. True if they are legal and leave one color.
+bool checkMoves(board b, const vector<Move> & moves) {
+	for (auto & m : moves) {
+		if (m.y < 0 or m.y >= (int)b.size() or m.x < 0 or m.x >= (int)b[0].size()) return false;
+		if (applyMove(b,m.x,m.y,m.color) == 0) return false;
+	}
+	for (auto & row : b) {
+		for (int val : row) {
+			if (val != b[0][0]) return false;
+		}
+	}
+	return true;
+}
+
+// Baseline entries, keyed by "<level> <engine>".
+struct BaselineEntry {
+	double seconds;
+	unsigned long nodes;
+};
+
+map<string,BaselineEntry> readBaseline(string path) {
+	map<string,BaselineEntry> res;
+	ifstream file(path);
+	string line;
+	while (getline(file,line)) {
+		if (line.size() == 0 or line[0] == '#') continue;
+		istringstream in(line);
+		string level, engine;
+		BaselineEntry e;
+		if (in >> level >> engine >> e.seconds >> e.nodes) res[level + " " + engine] = e;
+	}
+	return res;
+}
+
+int runRegression(RegressOptions & options) {
+	vector<string> levels;
+	error_code err;
+	for (auto & entry : filesystem::directory_iterator(options.levelsDir,err)) {
+		if (entry.is_regular_file() and entry.path().extension() == ".txt") levels.push_back(entry.path().stem());
+	}
+	if (err or levels.size() == 0) {
+		cout << "No levels found in '" << options.levelsDir << "'.\n";
+		return 4;
+	}
+	sort(levels.begin(),levels.end());
+	map<string,BaselineEntry> baseline;
+	map<string,BaselineEntry> measured;
+	if (options.baselinePath != "" and !options.saveBaseline) baseline = readBaseline(options.baselinePath);
+	double slack = options.tolerance / 100.0;
+	int failures = 0;
+
+	for (auto & level : levels) {
+		board b;
+		int minSol, maxSol;
+		if (!readLevel(options.levelsDir + "/" + level + ".txt",b,minSol,maxSol)) {
+			cout << level << ": FAIL (could not read level)\n";
+			failures++;
+			continue;
+		}
+		int expected = recordedMoves(options.solutionsDir + "/" + level + ".txt");
+		if (expected == -1 and minSol > 0 and minSol + 1 == maxSol) expected = minSol; // Hints agree on the optimum.
+		int zoneCount;
+		vector<int> zoneColors;
+		board zones = genZones(b,zoneCount,zoneColors);
+		graph g = genGraph(zones,zoneCount,zoneColors);
+		int agreed = -1; // The move count every engine so far has found.
+		for (Engine engine : options.engines) {
+			string name = engineName(engine);
+			SolveOptions solveOptions;
+			solveOptions.engine = engine;
+			solveOptions.strategy = options.strategy;
+			solveOptions.orderMoves = options.orderMoves;
+			solveOptions.quiet = true;
+			solveOptions.maxTime = options.maxTime;
+			if (options.useHints) {
+				solveOptions.minSol = minSol;
+				solveOptions.maxSol = maxSol;
+			}
+			SolveResult result;
+			auto start = chrono::steady_clock::now();
+			solve(g,zones,solveOptions,result);
+			double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			int moves = result.moves.size();
+
+			string problem;
+			if (!result.complete) {
+				problem = "timed out";
+			} else if (result.boards.size() == 0) {
+				problem = "no solution";
+			} else if (!checkMoves(b,result.moves)) {
+				problem = "invalid solution";
+			} else if (expected != -1 and moves != expected) {
+				problem = to_string(moves) + " moves, expected " + to_string(expected);
+			} else if (agreed != -1 and moves != agreed) {
+				problem = to_string(moves) + " moves, other engines found " + to_string(agreed);
+			}
+			if (problem == "" and agreed == -1) agreed = moves;
+			string key = level + " " + name;
+			measured[key] = {seconds,result.iterations};
+			auto base = baseline.find(key);
+			if (problem == "" and base != baseline.end()) {
+				// Allow a little extra time, since short runs are noisy.
+				if (seconds > base->second.seconds * (1 + slack) + 0.05) {
+					problem = "slower than baseline (" + to_string(base->second.seconds) + "s)";
+				} else if (result.iterations > base->second.nodes * (1 + slack)) {
+					problem = "more nodes than baseline (" + to_string(base->second.nodes) + ")";
+				}
+			}
+			if (problem != "") failures++;
+			cout << left << setw(6) << level << " " << setw(9) << name << right;
+			cout << setw(3) << moves << " moves " << fixed << setprecision(3) << setw(9) << seconds << "s ";
+			cout << setw(10) << result.iterations << " nodes  " << (problem == "" ? "ok" : "FAIL (" + problem + ")") << "\n";
+		}
+		// Engine::Hierarchical isn't optimal, so it must not say its solutions are proven to be,
+		// since '-json' and the other outputs call them optimal if they are.
+		if (expected != -1) {
+			SolveOptions solveOptions;
+			solveOptions.engine = Engine::Hierarchical;
+			solveOptions.quiet = true;
+			solveOptions.maxTime = options.maxTime;
+			SolveResult result;
+			solve(g,zones,solveOptions,result);
+			if (result.proven and (int)result.moves.size() != expected) {
+				cout << level << ": FAIL (hierarchical claims " << result.moves.size() << " moves is optimal, expected " << expected << ")\n";
+				failures++;
+			}
+		}
+	}
+
+	if (options.saveBaseline and options.baselinePath != "") {
+		ofstream out(options.baselinePath);
+		out << "# level engine seconds nodes\n";
+		for (auto & entry : measured) {
+			out << entry.first << " " << fixed << setprecision(4) << entry.second.seconds << " " << entry.second.nodes << "\n";
+		}
+		cout << "Baseline stored to " << options.baselinePath << "\n";
+	}
+	if (failures > 0) {
+		cout << failures << " failure(s).\n";
+		return 4;
+	}
+	cout << "All levels passed.\n";
+	return 0;
+}
@@ -0,0 +1,28 @@
+#ifndef Regress_H
+#define Regress_H
+
+#include <string>
+#include <vector>
+#include "solver.h"
+
+// Settings for the regression runner.
+struct RegressOptions {
+	std::string levelsDir = "3ds_levels";
+	std::string solutionsDir = "3ds_solutions"; // Recorded solutions, for the expected move counts.
+	std::vector<Engine> engines = {Engine::BestFirst}; // Every level is solved with each of these.
+	Strategy strategy = Strategy::Classic; // The strategy Engine::BestFirst uses.
+	bool orderMoves = false; // Search promising moves first (see SolveOptions).
+	bool useHints = true; // Pass each level's '-min' and '-max' hints to the solver.
+	unsigned int maxTime = 0; // Time limit per solve, in seconds. '0' means 'none'.
+	std::string baselinePath; // Stored times and node counts to compare against. Empty means none.
+	bool saveBaseline = false; // Write this run's times and node counts to 'baselinePath' instead.
+	int tolerance = 50; // Percent a level's time or node count may grow past the baseline before failing.
+};
+
+// Solves every level, and checks each solution is valid and as short as the recorded optimum.
+// Also checks the engines agree, that Engine::Hierarchical never claims a longer solution is
+// proven optimal, and compares against the baseline.
+// Returns the exit code for the program: 0 if everything passed, 4 otherwise.
+int runRegression(RegressOptions & options);
+
+#endif
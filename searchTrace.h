@@ -0,0 +1,141 @@
+#ifndef SearchTrace_H
+#define SearchTrace_H
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <fstream>
+#include <algorithm>
+
+// Samplers for the best-first search loop. The loop is a template over one of these,
+// so 'NullTrace' compiles away entirely when tracing is off.
+// 'expanded' is called for each path searched, 'improved' for each new best solution,
+// 'sample' once per path with the current sizes (it only records every 'interval'),
+// and 'finish' once at the end.
+
+struct NullTrace {
+	void expanded(int) {}
+	void improved(int) {}
+	void sample(size_t, size_t, int, unsigned long) {}
+	void finish(size_t, size_t, int, unsigned long) {}
+};
+
+// Records the search over time, and writes it out when destroyed.
+// Paths ending in '.json' get Chrome's trace_event format (load it in chrome://tracing or Perfetto);
+// anything else gets CSV, with one row per sample.
+class SearchTrace {
+protected:
+	struct Sample {
+		double seconds;
+		unsigned long nodes;
+		size_t frontier; // Paths in the open list.
+		size_t seen; // Colorings in the duplicate table.
+		int maxSol; // The best solution so far (exclusive), or -1.
+		double rate; // Nodes per second since the last sample.
+		std::vector<unsigned long> depths; // Paths searched at each move count since the last sample.
+	};
+	std::string path;
+	std::chrono::steady_clock::duration interval;
+	std::chrono::steady_clock::time_point start;
+	std::chrono::steady_clock::time_point next; // When the next sample is due.
+	std::vector<Sample> samples;
+	std::vector<std::pair<double,int>> solutions; // When each new best was found, and its length.
+	std::vector<unsigned long> depths;
+	unsigned long lastNodes = 0;
+	double lastSeconds = 0;
+
+	double elapsed() const {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void record(size_t frontier, size_t seen, int maxSol, unsigned long nodes) {
+		auto now = std::chrono::steady_clock::now();
+		next = now + interval;
+		double seconds = std::chrono::duration<double>(now - start).count();
+		double rate = seconds > lastSeconds ? (nodes - lastNodes) / (seconds - lastSeconds) : 0;
+		samples.push_back({seconds,nodes,frontier,seen,maxSol,rate,depths});
+		depths.clear();
+		lastNodes = nodes;
+		lastSeconds = seconds;
+	}
+
+	void writeCsv(std::ofstream & out, size_t maxDepth) {
+		out << "seconds,nodes,frontier,seen,maxSol,nodesPerSec";
+		for (size_t d = 0; d < maxDepth; d++) out << ",depth" << d;
+		out << "\n";
+		for (auto & s : samples) {
+			out << s.seconds << "," << s.nodes << "," << s.frontier << "," << s.seen << "," << s.maxSol << "," << s.rate;
+			for (size_t d = 0; d < maxDepth; d++) out << "," << (d < s.depths.size() ? s.depths[d] : 0);
+			out << "\n";
+		}
+	}
+
+	// Counter events for each sample, and an instant event for each new best solution.
+	void writeChrome(std::ofstream & out, size_t maxDepth) {
+		out << "{\"traceEvents\": [\n";
+		bool first = true;
+		auto event = [&](std::string name, double seconds, std::string args) {
+			out << (first ? "" : ",\n");
+			first = false;
+			out << "{\"name\": \"" << name << "\", \"ph\": \"C\", \"pid\": 1, \"tid\": 1, \"ts\": ";
+			out << (long)(seconds * 1e6) << ", \"args\": {" << args << "}}";
+		};
+		for (auto & s : samples) {
+			event("lists",s.seconds,"\"frontier\": " + std::to_string(s.frontier) + ", \"seen\": " + std::to_string(s.seen));
+			event("maxSol",s.seconds,"\"maxSol\": " + std::to_string(s.maxSol));
+			event("nodes/sec",s.seconds,"\"rate\": " + std::to_string((long)s.rate));
+			std::string args;
+			for (size_t d = 0; d < maxDepth; d++) {
+				if (d > 0) args += ", ";
+				args += "\"" + std::to_string(d) + " moves\": " + std::to_string(d < s.depths.size() ? s.depths[d] : 0);
+			}
+			event("depths",s.seconds,args);
+		}
+		for (auto & sol : solutions) {
+			out << (first ? "" : ",\n");
+			first = false;
+			out << "{\"name\": \"solution: " << sol.second << " moves\", \"ph\": \"i\", \"s\": \"g\", \"pid\": 1, \"tid\": 1, \"ts\": ";
+			out << (long)(sol.first * 1e6) << "}";
+		}
+		out << "\n]}\n";
+	}
+
+public:
+	// 'interval' is in milliseconds.
+	SearchTrace(std::string path, unsigned int interval) : path(path), interval(std::chrono::milliseconds(interval)) {
+		start = std::chrono::steady_clock::now();
+		next = start;
+	}
+
+	~SearchTrace() {
+		size_t maxDepth = 0;
+		for (auto & s : samples) maxDepth = std::max(maxDepth,s.depths.size());
+		std::ofstream out(path);
+		if (path.size() >= 5 and path.substr(path.size() - 5) == ".json") {
+			writeChrome(out,maxDepth);
+		} else {
+			writeCsv(out,maxDepth);
+		}
+	}
+
+	void expanded(int depth) {
+		if ((size_t)depth >= depths.size()) depths.resize(depth + 1);
+		depths[depth]++;
+	}
+
+	void improved(int moves) {
+		solutions.push_back({elapsed(),moves});
+	}
+
+	void sample(size_t frontier, size_t seen, int maxSol, unsigned long nodes) {
+		if (nodes % 16 != 0) return; // Only check the clock now and then.
+		if (std::chrono::steady_clock::now() < next) return;
+		record(frontier,seen,maxSol,nodes);
+	}
+
+	void finish(size_t frontier, size_t seen, int maxSol, unsigned long nodes) {
+		record(frontier,seen,maxSol,nodes);
+	}
+};
+
+#endif
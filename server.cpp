@@ -0,0 +1,460 @@
+#include <vector>
+#include <string>
+#include <map>
+#include <deque>
+#include <memory>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <climits>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "server.h"
+
+using namespace std;
+typedef struct Graph graph;
+typedef vector<vector<int>> board;
+
+// A parsed JSON value. Only as much of JSON as requests need.
+struct JsonValue {
+	enum Type {Null, Bool, Number, String, Array, Object} type = Null;
+	bool boolean = false;
+	double number = 0;
+	string str;
+	vector<JsonValue> items; // For arrays.
+	map<string,JsonValue> fields; // For objects.
+
+	bool has(string key) const {return type == Object and fields.find(key) != fields.end();}
+	const JsonValue & operator [](string key) const {return fields.at(key);}
+};
+
+// A recursive-descent JSON parser. Throws a string on bad input.
+class JsonParser {
+protected:
+	const string & text;
+	size_t pos = 0;
+
+	void skipSpace() {
+		while (pos < text.size() and (text[pos] == ' ' or text[pos] == '\t' or text[pos] == '\r' or text[pos] == '\n')) pos++;
+	}
+
+	char peek() {
+		skipSpace();
+		if (pos >= text.size()) throw "unexpected end of input"s;
+		return text[pos];
+	}
+
+	void expect(char c) {
+		if (peek() != c) throw "expected '"s + c + "' at position " + to_string(pos);
+		pos++;
+	}
+
+	// Matches a keyword such as 'true'.
+	bool keyword(string word) {
+		if (text.compare(pos,word.size(),word) != 0) return false;
+		pos += word.size();
+		return true;
+	}
+
+	string parseString() {
+		expect('"');
+		string res;
+		while (true) {
+			if (pos >= text.size()) throw "unterminated string"s;
+			char c = text[pos++];
+			if (c == '"') break;
+			if (c != '\\') {
+				res += c;
+				continue;
+			}
+			if (pos >= text.size()) throw "unterminated string"s;
+			c = text[pos++];
+			switch (c) {
+				case 'n': res += '\n'; break;
+				case 't': res += '\t'; break;
+				case 'r': res += '\r'; break;
+				case 'b': res += '\b'; break;
+				case 'f': res += '\f'; break;
+				case 'u': // Only ASCII escapes are supported.
+					if (pos + 4 > text.size()) throw "bad escape"s;
+					res += (char)stoi(text.substr(pos,4),nullptr,16);
+					pos += 4;
+					break;
+				default: res += c; // '"', '\\' and '/'.
+			}
+		}
+		return res;
+	}
+
+public:
+	JsonParser(const string & text) : text(text) {}
+
+	JsonValue parse() {
+		JsonValue res;
+		char c = peek();
+		if (c == '{') {
+			res.type = JsonValue::Object;
+			pos++;
+			if (peek() == '}') {pos++; return res;}
+			while (true) {
+				string key = parseString();
+				expect(':');
+				res.fields[key] = parse();
+				if (peek() == ',') {pos++; continue;}
+				expect('}');
+				return res;
+			}
+		} else if (c == '[') {
+			res.type = JsonValue::Array;
+			pos++;
+			if (peek() == ']') {pos++; return res;}
+			while (true) {
+				res.items.push_back(parse());
+				if (peek() == ',') {pos++; continue;}
+				expect(']');
+				return res;
+			}
+		} else if (c == '"') {
+			res.type = JsonValue::String;
+			res.str = parseString();
+		} else if (keyword("true")) {
+			res.type = JsonValue::Bool;
+			res.boolean = true;
+		} else if (keyword("false")) {
+			res.type = JsonValue::Bool;
+		} else if (keyword("null")) {
+			res.type = JsonValue::Null;
+		} else {
+			size_t used = 0;
+			try {
+				res.number = stod(text.substr(pos,32),&used);
+			} catch (...) {
+				throw "unexpected character at position "s + to_string(pos);
+			}
+			res.type = JsonValue::Number;
+			pos += used;
+		}
+		return res;
+	}
+
+	// Parses the whole text as one value.
+	JsonValue parseAll() {
+		JsonValue res = parse();
+		skipSpace();
+		if (pos != text.size()) throw "trailing characters at position "s + to_string(pos);
+		return res;
+	}
+};
+
+// Quotes and escapes a string for JSON output.
+string jsonQuote(string s) {
+	string res = "\"";
+	for (char c : s) {
+		if (c == '"' or c == '\\') {
+			res += '\\';
+			res += c;
+		} else if (c == '\n') {
+			res += "\\n";
+		} else if ((unsigned char)c < 0x20) {
+			res += ' ';
+		} else {
+			res += c;
+		}
+	}
+	return res + "\"";
+}
+
+// Writes a JSON value back out. Used to echo request ids.
+string jsonWrite(const JsonValue & v) {
+	switch (v.type) {
+		case JsonValue::Bool: return v.boolean ? "true" : "false";
+		case JsonValue::Number: {
+			if (v.number == (long)v.number) return to_string((long)v.number);
+			return to_string(v.number);
+		}
+		case JsonValue::String: return jsonQuote(v.str);
+		case JsonValue::Array: {
+			string res = "[";
+			for (uint i = 0; i < v.items.size(); i++) {
+				if (i > 0) res += ", ";
+				res += jsonWrite(v.items[i]);
+			}
+			return res + "]";
+		}
+		case JsonValue::Object: {
+			string res = "{";
+			bool first = true;
+			for (auto & field : v.fields) {
+				if (!first) res += ", ";
+				first = false;
+				res += jsonQuote(field.first) + ": " + jsonWrite(field.second);
+			}
+			return res + "}";
+		}
+		default: return "null";
+	}
+}
+
+// Formats a move list the same way as '-json'.
+string jsonMoves(const vector<Move> & moves) {
+	string res = "[";
+	for (uint i = 0; i < moves.size(); i++) {
+		if (i > 0) res += ", ";
+		res += "{\"x\": " + to_string(moves[i].x) + ", \"y\": " + to_string(moves[i].y) + ", \"color\": " + to_string(moves[i].color) + "}";
+	}
+	return res + "]";
+}
+
+// Reads the "board" field: either a list of row strings, or one string with a row per line.
+// Spaces are ignored. Throws a string on bad input.
+board parseBoard(const JsonValue & v) {
+	vector<string> rows;
+	if (v.type == JsonValue::Array) {
+		for (auto & item : v.items) {
+			if (item.type != JsonValue::String) throw "board rows must be strings"s;
+			rows.push_back(item.str);
+		}
+	} else if (v.type == JsonValue::String) {
+		string row;
+		for (char c : v.str + "\n") {
+			if (c == '\n') {
+				rows.push_back(row);
+				row = "";
+			} else {
+				row += c;
+			}
+		}
+	} else {
+		throw "board must be a string or a list of strings"s;
+	}
+	board result;
+	for (auto & rowStr : rows) {
+		vector<int> row;
+		for (char c : rowStr) {
+			if (c == ' ' or c == '\t' or c == '\r') continue;
+			if (not (c >= '0' and c <= '9')) throw "non-int character in board"s;
+			row.push_back(c - '0');
+		}
+		if (row.size() == 0) continue; // Ignore empty lines.
+		if (result.size() > 0 and row.size() != result[0].size()) throw "lines are different lengths"s;
+		result.push_back(row);
+	}
+	if (result.size() == 0) throw "no board provided"s;
+	return result;
+}
+
+// Where replies go. Shared by all requests from one client.
+class Connection {
+protected:
+	int fd; // -1 means stdout.
+	mutex lock;
+public:
+	Connection(int fd) : fd(fd) {}
+	~Connection() {if (fd != -1) close(fd);}
+
+	// Sends one line. Lines from different threads never interleave.
+	void send(string line) {
+		lock_guard<mutex> guard(lock);
+		line += '\n';
+		if (fd == -1) {
+			cout << line << flush;
+			return;
+		}
+		size_t sent = 0;
+		while (sent < line.size()) {
+			ssize_t res = ::send(fd,line.data() + sent,line.size() - sent,MSG_NOSIGNAL);
+			if (res <= 0) return; // Client went away. Nothing more to do.
+			sent += res;
+		}
+	}
+};
+
+// A request waiting for a worker.
+struct Job {
+	shared_ptr<Connection> client;
+	string line;
+};
+
+// A queue of jobs, shared by all workers.
+class JobQueue {
+protected:
+	deque<Job> jobs;
+	mutex lock;
+	condition_variable ready;
+	bool closed = false;
+public:
+	void push(Job job) {
+		{
+			lock_guard<mutex> guard(lock);
+			jobs.push_back(job);
+		}
+		ready.notify_one();
+	}
+
+	// No more jobs will be added. Workers stop once the queue is empty.
+	void close() {
+		{
+			lock_guard<mutex> guard(lock);
+			closed = true;
+		}
+		ready.notify_all();
+	}
+
+	// Waits for a job. Returns false once the queue is closed and empty.
+	bool pop(Job & job) {
+		unique_lock<mutex> guard(lock);
+		ready.wait(guard,[this]{return closed or !jobs.empty();});
+		if (jobs.empty()) return false;
+		job = jobs.front();
+		jobs.pop_front();
+		return true;
+	}
+};
+
+// Reads a field that must be a whole number from 0 to 'most'. Throws a string on bad input.
+unsigned long parseCount(const JsonValue & v, const string & name, double most) {
+	if (v.type != JsonValue::Number) throw "\"" + name + "\" must be a number";
+	if (v.number < 0 or v.number > most or v.number != (unsigned long)v.number) throw "\"" + name + "\" must be a whole number from 0 to " + to_string((unsigned long)most);
+	return v.number;
+}
+
+// Solves one request, sending replies as it goes.
+void handleRequest(Job & job, ServerOptions & options, mutex & cacheLock) {
+	string id = "null";
+	string prefix = "{\"id\": null";
+	try {
+		JsonValue request = JsonParser(job.line).parseAll();
+		if (request.type != JsonValue::Object) throw "request must be an object"s;
+		if (request.has("id")) id = jsonWrite(request["id"]);
+		prefix = "{\"id\": " + id;
+		if (!request.has("board")) throw "missing \"board\""s;
+		board b = parseBoard(request["board"]);
+
+		SolveOptions solveOptions;
+		solveOptions.quiet = true;
+		solveOptions.maxTime = options.maxTime;
+		solveOptions.maxNodes = options.maxNodes;
+		if (request.has("t")) solveOptions.maxTime = parseCount(request["t"],"t",UINT_MAX);
+		if (request.has("nodes")) solveOptions.maxNodes = parseCount(request["nodes"],"nodes",1e15);
+		if (request.has("min")) solveOptions.minSol = parseCount(request["min"],"min",INT_MAX - 1);
+		if (request.has("max")) solveOptions.maxSol = parseCount(request["max"],"max",INT_MAX - 1) + 1; // Exclusive, as with '-max='.
+		solveOptions.onImprove = [&](const vector<Move> & moves) {
+			job.client->send(prefix + ", \"status\": \"improved\", \"moveCount\": " + to_string(moves.size()) + ", \"moves\": " + jsonMoves(moves) + "}");
+		};
+
+		int zoneCount;
+		vector<int> zoneColors;
+		board zones = genZones(b,zoneCount,zoneColors);
+		graph g = genGraph(zones,zoneCount,zoneColors);
+		SolveResult result;
+		bool cached = false;
+		if (options.cache != nullptr) {
+			vector<Move> found;
+			bool proven;
+			lock_guard<mutex> guard(cacheLock);
+			if (options.cache->lookup(g,solveOptions.minSol,solveOptions.maxSol,found,proven)) {
+				cached = replay(g,zones,found,result);
+				result.proven = proven;
+			}
+		}
+		if (!cached) {
+			solve(g,zones,solveOptions,result);
+			if (options.cache != nullptr and result.complete and result.moves.size() > 0) {
+				lock_guard<mutex> guard(cacheLock);
+				options.cache->store(g,result.moves,result.proven);
+			}
+		}
+		bool solved = result.boards.size() > 0;
+		string reply = prefix + ", \"status\": \"done\"";
+		reply += ", \"solved\": "s + (solved ? "true" : "false");
+		reply += ", \"optimal\": "s + (solved and result.proven ? "true" : "false");
+		reply += ", \"cached\": "s + (cached ? "true" : "false");
+		reply += ", \"nodes\": " + to_string(result.iterations);
+		reply += ", \"moveCount\": " + to_string(result.moves.size());
+		reply += ", \"moves\": " + jsonMoves(result.moves) + "}";
+		job.client->send(reply);
+	} catch (string & error) {
+		job.client->send(prefix + ", \"status\": \"error\", \"message\": " + jsonQuote(error) + "}");
+	} catch (exception & error) {
+		job.client->send(prefix + ", \"status\": \"error\", \"message\": " + jsonQuote(error.what()) + "}");
+	}
+}
+
+// Reads lines from a client, and queues each non-empty one as a job.
+void readSocket(shared_ptr<Connection> client, int fd, JobQueue & queue) {
+	string line;
+	char buffer[4096];
+	while (true) {
+		ssize_t got = recv(fd,buffer,sizeof(buffer),0);
+		if (got <= 0) break;
+		for (ssize_t i = 0; i < got; i++) {
+			if (buffer[i] != '\n') {
+				line += buffer[i];
+				continue;
+			}
+			if (line.find_first_not_of(" \t\r") != string::npos) queue.push({client,line});
+			line = "";
+		}
+	}
+	// The connection stays open until its last job replies.
+	shutdown(fd,SHUT_RD);
+}
+
+int runServer(ServerOptions & options) {
+	JobQueue queue;
+	mutex cacheLock;
+	vector<thread> workers;
+	if (options.threads == 0) options.threads = 1;
+	for (uint i = 0; i < options.threads; i++) {
+		workers.emplace_back([&]() {
+			Job job;
+			while (queue.pop(job)) {
+				handleRequest(job,options,cacheLock);
+				job = Job(); // Release the connection.
+			}
+		});
+	}
+
+	if (options.socketPath == "") {
+		// Read requests from stdin until it closes.
+		auto client = make_shared<Connection>(-1);
+		string line;
+		while (getline(cin,line)) {
+			if (line.find_first_not_of(" \t\r") != string::npos) queue.push({client,line});
+		}
+		queue.close();
+		for (auto & worker : workers) worker.join();
+		return 0;
+	}
+
+	// Listen on a Unix domain socket, forever.
+	// Stops the idle workers on the way out, since threads can't be destroyed while running.
+	auto fail = [&](const string & message) {
+		cerr << message << ": " << options.socketPath << "\n";
+		queue.close();
+		for (auto & worker : workers) worker.join();
+		return 1;
+	};
+	int listener = socket(AF_UNIX,SOCK_STREAM,0);
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (listener == -1 or options.socketPath.size() >= sizeof(address.sun_path)) return fail("Failed to create socket");
+	options.socketPath.copy(address.sun_path,options.socketPath.size());
+	// Remove a stale socket from an earlier run, but nothing else that might be at the path.
+	struct stat existing;
+	if (lstat(options.socketPath.c_str(),&existing) == 0) {
+		if (!S_ISSOCK(existing.st_mode)) return fail("Not a socket, so not replacing it");
+		unlink(options.socketPath.c_str());
+	}
+	if (bind(listener,(sockaddr *)&address,sizeof(address)) != 0 or listen(listener,16) != 0) return fail("Failed to listen on socket");
+	cerr << "Listening on " << options.socketPath << "\n";
+	while (true) {
+		int fd = accept(listener,nullptr,nullptr);
+		if (fd == -1) continue;
+		auto client = make_shared<Connection>(fd);
+		thread(readSocket,client,fd,ref(queue)).detach();
+	}
+}
@@ -0,0 +1,25 @@
+#ifndef Server_H
+#define Server_H
+
+#include <string>
+#include "solver.h"
+#include "cache.h"
+
+// Settings for server mode.
+struct ServerOptions {
+	std::string socketPath; // A Unix domain socket to listen on. Empty means stdin/stdout.
+	unsigned int threads = 1; // Number of requests to solve at once.
+	unsigned int maxTime = 0; // Default time limit per request, in seconds. '0' means 'none'.
+	unsigned long maxNodes = 0; // Default node limit per request. '0' means 'none'.
+	SolutionCache * cache = nullptr; // Shared between all requests, if set.
+};
+
+// Solves boards sent as line-delimited JSON, one request per line, e.g.
+// {"id": 1, "board": ["112", "221", "313"], "t": 5, "nodes": 100000, "min": 3, "max": 3}
+// Only "board" is required. Replies are also one JSON object per line, tagged with the request's "id".
+// Each improved solution is sent as it is found ("status": "improved"), then a final reply
+// ("status": "done" or "error").
+// Returns the exit code for the program.
+int runServer(ServerOptions & options);
+
+#endif
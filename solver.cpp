@@ -4,14 +4,33 @@
 #include <algorithm>
 #include <unordered_map>
 #include <map>
+#include <set>
 #include <unordered_set>
 #include <string>
 #include <cmath>
 #include <memory>
 #include <queue>
+#include <deque>
 #include <iostream>
-#include <ctime>
+#include <chrono>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <unistd.h>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <climits>
+#include <tuple>
+#include <random>
 #include "solver.h"
+#include "fixedSearch.h"
+#include "searchTrace.h"
+#include "memstats.h"
+#include "symmetry.h"
+#include "hierarchy.h"
+#include "checkpoint.h"
+#include "packedColoring.h"
 
 using namespace std;
 typedef vector<int> vInt;
@@ -35,8 +54,6 @@ T pop(priority_queue<T> & q) {
 	return res;
 }
 
-// Further down, there is an additional variant of 'pop' for priority_queue_Path
-
 // Creates a graph representation, for debugging purposes.
 string graphShow(struct Graph g) {
 	string res;
@@ -128,7 +145,7 @@ public:
 	int operator [](int i) {return data[i];}
 	
 	// Counts number of nonzero vals.
-	int count() {
+	int count() const {
 		return countVal;
 	}
 	
@@ -237,14 +254,32 @@ public:
 
 // Tracks the distance between every pair of nodes in a graph.
 // Maintains a square grid, even though one half is unused (since the coordinate math is easier)
+// out[v] = max(out[v], min(limit, a[v] + b[v] - 2)) for each of 'n' nodes: one pair's pass in
+// 'mergedBounds'. Apart from DistTracker so the loop sees only locals, and built with the full
+// vectorizer cost model, since -O2 only vectorizes loops whose trip count needs no epilogue.
+__attribute__((optimize("tree-vectorize","vect-cost-model=dynamic")))
+static void raiseBounds(int * __restrict out, const int * __restrict a, const int * __restrict b, int limit, int n) {
+	// Not std::min and std::max: they won't inline into a function built with other options.
+	for (int v = 0; v < n; v++) {
+		int merged = a[v] + b[v] - 2 < limit ? a[v] + b[v] - 2 : limit;
+		out[v] = out[v] > merged ? out[v] : merged;
+	}
+}
+
 // Generates distances with iterative Dijkstra's for each node. O(n^3).
 // Can do update by combining nodes (and using lowest value for each dist),
 // then Floyd-Warshal for k=mergedNode only. O(n^2).
+// Graphs of more than 'fullMatrixZones' nodes get landmark mode instead: only the distances from a
+// few far-apart landmark nodes are kept, O(n) each, and the greatest distance is only a lower bound
+// (the greatest distance from a landmark). A merge is one breadth-first search from the merged node.
 class DistTracker {
 protected:
-	vector<int> distances;
+	vector<int> distances; // In landmark mode, a row per landmark of its distance to each node.
 	int size = 0; // width and height of square.
 	int greatestDist = -1; // Greatest distance between nodes.
+	vInt landmarks; // The node each landmark is now part of. Empty unless in landmark mode.
+	static const int fullMatrixZones = 128;
+	static const int landmarkCount = 16;
 	
 	// Same as '()'.
 	// For internal use, to make syntax easier to read.
@@ -286,13 +321,98 @@ protected:
 		return dist; // The distance of the furthest node.
 	}
 	
+	// Fills 'row' with each node's distance from 'node', and returns the greatest.
+	static int breadthFirst(graph & g, int node, int * row) {
+		fill(row,row + g.nodeCount,-1);
+		queue<int> nodes;
+		row[node] = 0;
+		nodes.push(node);
+		int dist = 0;
+		while (!nodes.empty()) {
+			int next = pop(nodes);
+			dist = row[next];
+			for (int other : g.adjacent[next]) {
+				if (row[other] != -1) continue;
+				row[other] = dist + 1;
+				nodes.push(other);
+			}
+		}
+		return dist;
+	}
+	
+	// Picks each landmark as far as it can be from those already picked, starting with the node
+	// farthest from node 0, and fills in their rows.
+	void pickLandmarks(graph & g) {
+		int count = min(landmarkCount,size);
+		distances = vector<int>(count * size);
+		vInt nearest(size); // Each node's distance from the nearest landmark so far.
+		breadthFirst(g,0,nearest.data());
+		greatestDist = 0;
+		for (int l = 0; l < count; l++) {
+			int farthest = max_element(nearest.begin(),nearest.end()) - nearest.begin();
+			landmarks.push_back(farthest);
+			int * row = &distances[l * size];
+			greatestDist = max(greatestDist,breadthFirst(g,farthest,row));
+			for (int v = 0; v < size; v++) nearest[v] = l == 0 ? row[v] : min(nearest[v],row[v]);
+		}
+	}
+	
+	// 'reduce', in landmark mode. A path from a landmark either avoids the merged node, and is
+	// no longer than before, or goes through it. So each new distance is the least of the old
+	// ones it was merged from, or the landmark's distance to the merged node plus the merged node's
+	// distance onwards, found by searching from it in 'g' (the merged graph).
+	void reduceLandmarks(Remapper & red, int mergedNode, graph & g) {
+		int nodeCount = red.getNextFree();
+		vInt newOf(size);
+		for (int x = 0; x < size; x++) newOf[x] = red[x];
+		vInt fromMerged(nodeCount);
+		int max = breadthFirst(g,mergedNode,fromMerged.data());
+		vector<int> newDist(landmarks.size() * nodeCount,INT_MAX);
+		for (uint l = 0; l < landmarks.size(); l++) {
+			const int * old = &distances[l * size];
+			int * row = &newDist[l * nodeCount];
+			for (int x = 0; x < size; x++) row[newOf[x]] = min(row[newOf[x]],old[x]);
+			int toMerged = row[mergedNode];
+			for (int v = 0; v < nodeCount; v++) {
+				row[v] = min(row[v],toMerged + fromMerged[v]);
+				if (row[v] > max) max = row[v];
+			}
+			landmarks[l] = newOf[landmarks[l]];
+		}
+		distances = newDist;
+		size = nodeCount;
+		greatestDist = max;
+	}
 	
+	// 'mergedBounds', in landmark mode.
+	vInt landmarkMergedBounds(int pairLimit) const {
+		vInt res(size,0);
+		vector<tuple<int,int,int>> pairs; // (distance, landmark, landmark)
+		for (uint i = 0; i < landmarks.size(); i++) {
+			for (uint j = i + 1; j < landmarks.size(); j++) pairs.push_back({distances[i * size + landmarks[j]],i,j});
+		}
+		int keep = min((int)pairs.size(),pairLimit);
+		partial_sort(pairs.begin(),pairs.begin() + keep,pairs.end(),greater<tuple<int,int,int>>());
+		for (int p = 0; p < keep; p++) {
+			int dist = get<0>(pairs[p]);
+			const int * a = &distances[get<1>(pairs[p]) * size];
+			const int * b = &distances[get<2>(pairs[p]) * size];
+			raiseBounds(res.data(),a,b,dist,size);
+		}
+		return res;
+	}
+
 public:
 
 	DistTracker() {}
 	// Figure out distances
 	DistTracker(graph & g) {
+		MemScope scope(MemTag::Distances);
 		size = g.nodeCount;
+		if (size > fullMatrixZones) {
+			pickLandmarks(g);
+			return;
+		}
 		// Create distance table.
 		distances = vector<int>(size*size,-1);
 		// Start with iterative Dijkstra's.
@@ -307,7 +427,59 @@ public:
 		greatestDist = max;
 	}
 	
-	// like [], but allows an x and y pair.
+	// Repairs the distances of 'old' after a local change to its graph, giving those of 'g'.
+	// 'oldToNew' maps each old node to its node in 'g', or -1 if it was replaced,
+	// and 'changed' lists the nodes of 'g' that replaced them.
+	// Only rows that could have changed are searched again: the changed nodes, and nodes
+	// with a shortest path through a replaced node. The rest keep their old distances,
+	// shortened by any new route through a changed node.
+	// In landmark mode, the distances are found afresh instead.
+	DistTracker(graph & g, DistTracker & old, vInt & oldToNew, vInt & changed) {
+		MemScope scope(MemTag::Distances);
+		if (old.landmarks.size() > 0 or g.nodeCount > fullMatrixZones) {
+			*this = DistTracker(g);
+			return;
+		}
+		size = g.nodeCount;
+		distances = vector<int>(size*size,-1);
+		vInt replaced;
+		for (int node = 0; node < old.size; node++) {
+			if (oldToNew[node] == -1) replaced.push_back(node);
+		}
+		vector<bool> fresh(size,false); // Rows found by searching again.
+		for (int node : changed) {
+			dijkstra(node,g);
+			fresh[node] = true;
+		}
+		for (int u = 0; u < old.size; u++) {
+			if (oldToNew[u] == -1) continue;
+			bool stale = false;
+			for (int a : replaced) {
+				for (int v = 0; v < old.size and !stale; v++) {
+					if (oldToNew[v] != -1 and old(u,a) + old(a,v) == old(u,v)) stale = true;
+				}
+				if (stale) break;
+			}
+			if (!stale) continue;
+			dijkstra(oldToNew[u],g);
+			fresh[oldToNew[u]] = true;
+		}
+		for (int u = 0; u < old.size; u++) {
+			int uN = oldToNew[u];
+			if (uN == -1 or fresh[uN]) continue;
+			for (int v = 0; v < old.size; v++) {
+				int vN = oldToNew[v];
+				if (vN == -1 or fresh[vN]) continue;
+				int best = old(u,v);
+				for (int c : changed) best = min(best,pos(uN,c) + pos(c,vN));
+				pos(uN,vN) = best;
+			}
+		}
+		greatestDist = 0;
+		for (int d : distances) greatestDist = max(greatestDist,d);
+	}
+	
+	// like [], but allows an x and y pair. Not in landmark mode.
 	int& operator ()(int x, int y) {
 		return operator()(x,y,size,distances);
 	}
@@ -319,8 +491,33 @@ public:
 		return dists[x + y * size];
 	}
 	
+	// Copies are charged to MemTag::Distances, wherever they happen.
+	DistTracker(const DistTracker & other) : size(other.size), greatestDist(other.greatestDist) {
+		MemScope scope(MemTag::Distances);
+		distances = other.distances;
+		landmarks = other.landmarks;
+	}
+	
+	DistTracker & operator=(const DistTracker & other) {
+		MemScope scope(MemTag::Distances);
+		distances = other.distances;
+		size = other.size;
+		greatestDist = other.greatestDist;
+		landmarks = other.landmarks;
+		return *this;
+	}
+	
+	DistTracker(DistTracker &&) = default;
+	DistTracker & operator=(DistTracker &&) = default;
+	
 	// combines nodes in accordance with remapper, recalculates distances as needed.
-	void reduce(Remapper & red, int mergedNode) {
+	// 'g' is the graph after the merge.
+	void reduce(Remapper & red, int mergedNode, graph & g) {
+		MemScope scope(MemTag::Distances);
+		if (landmarks.size() > 0) {
+			reduceLandmarks(red,mergedNode,g);
+			return;
+		}
 		int nodeCount = red.getNextFree();
 		vector<int> newDist(nodeCount*nodeCount,-1);
 		// Merge cells, keeping smallest values.
@@ -356,7 +553,45 @@ public:
 		greatestDist = max;
 	}
 	
-	int greatest() {return greatestDist;}
+	// In landmark mode, only a lower bound.
+	int greatest() const {return greatestDist;}
+	
+	// The greatest distance from 'node' to any other. In landmark mode, only a lower bound.
+	int eccentricity(int node) {
+		int res = 0;
+		if (landmarks.size() > 0) {
+			for (uint l = 0; l < landmarks.size(); l++) res = max(res,distances[l * size + node]);
+		} else {
+			for (int other = 0; other < size; other++) res = max(res,pos(node,other));
+		}
+		return res;
+	}
+	
+	// For each node, a lower bound on the greatest distance left once it is merged with some of its
+	// neighbors. Merging a node 'v' brings each node at most one step nearer to it, so a pair 'x', 'y'
+	// stays at least min(d(x,y), d(x,v) + d(y,v) - 2) apart. Any pairs give a bound; the farthest
+	// apart (up to 'pairLimit' of them) give the best. Each pair is one pass over two distance rows,
+	// for every node at once. In landmark mode, the pairs are the farthest apart landmarks.
+	vInt mergedBounds(int pairLimit = 8) const {
+		if (landmarks.size() > 0) return landmarkMergedBounds(pairLimit);
+		vInt res(size,0);
+		vector<pair<int,int>> far;
+		for (int x = 0; x < size and (int)far.size() < pairLimit; x++) {
+			for (int y = x + 1; y < size and (int)far.size() < pairLimit; y++) {
+				if (distances[y + x * size] == greatestDist) far.push_back({x,y});
+			}
+		}
+		vInt rowX(size), rowY(size);
+		for (auto & pair : far) {
+			// Rows are stored in one half of the matrix, so gather them first.
+			for (int v = 0; v < size; v++) {
+				rowX[v] = v < pair.first ? distances[pair.first + v * size] : distances[v + pair.first * size];
+				rowY[v] = v < pair.second ? distances[pair.second + v * size] : distances[v + pair.second * size];
+			}
+			raiseBounds(res.data(),rowX.data(),rowY.data(),greatestDist,size);
+		}
+		return res;
+	}
 	
 	operator string() {
 		return this->b2str(distances,size);
@@ -375,13 +610,21 @@ public:
 	
 	// Struct equality.
 	bool operator==(DistTracker other) const {
-		return distances==other.distances and size==other.size and greatestDist==other.greatestDist;
+		return distances==other.distances and size==other.size and greatestDist==other.greatestDist and landmarks==other.landmarks;
 	}
 	
 	bool operator!=(DistTracker other) const {return !(*this==other);}
 	
 };
 
+// One more than the largest color in a graph. Used to size color tables.
+int colorLimit(const vInt & colors) {
+	int res = 0;
+	for (int c : colors) res = max(res,c + 1);
+	return res;
+}
+int colorLimit(graph & g) {return colorLimit(g.colors);}
+
 // A partially-completed search.
 // Note: original board state is not preserved,
 // simply color assignments by zone.
@@ -393,8 +636,11 @@ protected:
 	IntMultiSet colorCounts; // The number of instances of each color.
 	DistTracker dists; // The distances of each node pair
 	int movesMade = 0;
-	shared_ptr<LinkedList<vInt>> history; // A list of color mappings over time.
+	int orderRank = 0; // Where MoveOrdering put this path among its siblings. Breaks ties in the open lists.
+	int colorBits = 4; // Bits per zone in each coloring of 'history'.
+	shared_ptr<LinkedList<PackedColoring>> history; // A list of color mappings over time.
 	shared_ptr<LinkedList<graph>> historyG; // A list of previous graphs. For debugging purposes.
+	shared_ptr<LinkedList<Move>> moves; // The moves made so far, by original zone #. Empty at the start.
 public:
 	
 	// The default constructor is a ridiculously inefficient path.
@@ -404,17 +650,28 @@ public:
 		this->movesMade = 1000000;
 	}
 	
-	Path(graph state) : progress(state.nodeCount), colorCounts(10), dists(state) {
+	Path(graph state) : Path(state,DistTracker(state)) {}
+	
+	// Starts from a graph whose distances are already known.
+	Path(graph state, DistTracker dists) : progress(state.nodeCount), colorCounts(colorLimit(state)), dists(dists) {
+		MemScope scope(MemTag::Paths);
 		this->state = state;
 		initialNodeCount = state.nodeCount;
 		movesMade = 0;
-		history = make_shared<LinkedList<vInt>>(state.colors);
-		historyG = make_shared<LinkedList<graph>>(state);
+		colorBits = PackedColoring::bitsFor(colorLimit(state));
+		history = make_shared<LinkedList<PackedColoring>>(PackedColoring(state.colors,colorBits));
+		{
+			MemScope scope(MemTag::GraphHistory);
+			historyG = make_shared<LinkedList<graph>>(state);
+		}
 		colorCounts.tally(state.colors); // use for filtering.
 	}
 	
 	// Get a list of immediately-reachable states.
-	vector<Path> followingStates(int moveLimit) {
+	// Unless 'allWins' is set, a winning state is returned on its own.
+	// With 'symmetry', moves equivalent to another move under an automorphism are left out.
+	vector<Path> followingStates(int moveLimit, bool allWins = false, Symmetries * symmetry = nullptr) {
+		MemScope scope(MemTag::Paths);
 		vector<Path> result;
 		// says if a color must be eliminated this turn.
 		bool colorCapped = false;
@@ -427,69 +684,42 @@ public:
 			if (movesMade + colorCounts.count() == moveLimit) colorCapped = true;
 		}
 		
+		// Children whose greatest distance is sure to be too long are never built.
+		// Only worth a look if the parent's greatest distance is near too long itself.
+		vInt distBound;
+		int distLimit = 2 * (moveLimit - movesMade - 2); // The most a child's greatest distance can be.
+		if (moveLimit != -1 and dists.greatest() > distLimit) distBound = dists.mergedBounds();
+		
+		vector<bool> keep;
+		if (symmetry != nullptr) {
+			vInt nodeOf(initialNodeCount);
+			for (int zone = 0; zone < initialNodeCount; zone++) nodeOf[zone] = progress[zone];
+			keep = symmetricKeep(*symmetry,history->val.unpack(),nodeOf,state.nodeCount);
+		}
 		// For each node, try all reasonable actions
 		for (int node = 0; node < state.nodeCount; node++) {
 			// if colorCapped, require color count to be 1.
 			if (colorCapped and colorCounts[state.colors[node]] != 1) continue;
+			if (distBound.size() > 0 and distBound[node] > distLimit) continue;
 			
 			unordered_set<int> colorOptions;
 			// Make a list of color changes for the node.
 			for (int node2 : state.adjacent[node]) {
 				colorOptions.insert(state.colors[node2]);
 			}
+			if (symmetry != nullptr) {
+				symmetry->considered += colorOptions.size();
+				if (!keep[node]) {
+					symmetry->pruned += colorOptions.size();
+					continue;
+				}
+			}
 			// Iterate through valid colorings, adding necessary new options
 			for (int nColor : colorOptions) {
-				Path nPath(*this); // Copy the existing setup.
-				nPath.colorCounts.dec(nPath.state.colors[node]); // Decrement color count for color.
-				nPath.colorCounts.inc(nColor); // Increment color count for color.
-				nPath.state.colors[node] = nColor; // Change node color.
-				nPath.movesMade += 1; // One more move made.
-				Remapper reduction; // Remaps the node numbers.
-				// Find nodes to combine, and populate 'reduction'
-				vInt toMerge; // A list of nodes to merge with 'node'
-				for (int node2 = 0; node2 < state.nodeCount; node2++) {
-					// If the nodes should be merged.
-					if (node != node2 and
-						state.colors[node2] == nPath.state.colors[node] and
-						state.adjacent[node].find(node2) != state.adjacent[node].end())
-					{
-						// Do nothing this pass; we do these at the end.
-						toMerge.push_back(node2);
-					} else {
-						// No merge, new node.
-						reduction.next(node2);
-					}
-				}
-				for (auto node2 : toMerge) {
-					reduction[node2] = reduction[node]; // Rename node.
-					// Reduce color count for merged nodes.
-					nPath.colorCounts.dec(nColor);
-				}
-				
-				
-				
-				// Apply reduction to graph.
-				nPath.state = reduction.reduce(nPath.state);
-				// Apply reduction to distance-tracking.
-				nPath.dists.reduce(reduction,reduction[node]);
-				
-				
-				// track reductions, relative to initial state of board.
-				nPath.progress = nPath.progress.chain(reduction);
-				// Add an entry to 'history'
-				vInt newHEntry = vInt();
-				for (int i = 0; i < initialNodeCount; i++) {
-					// Add a new color entry, mapping from original zone #.
-					newHEntry.push_back(nPath.state.colors[nPath.progress[i]]);
-				}
-				// Update history. Since we are dealing with linked lists,
-				// we need to make a new node for each.
-				nPath.history = shared_ptr<LinkedList<vInt>>(new LinkedList(newHEntry,nPath.history));
-				nPath.historyG = shared_ptr<LinkedList<graph>>(new LinkedList(nPath.state,nPath.historyG));
-				
+				Path nPath = makeMove(node,nColor);
 				// If this is a winning state, then return only this.
 				// Everything else is extraneous.
-				if (nPath.done()) return {nPath};
+				if (nPath.done() and !allWins) return {nPath};
 				// Otherwise, append completed path.
 				result.push_back(nPath); // Finally, done with the new path.
 			}
@@ -497,6 +727,84 @@ public:
 		return result;
 	}
 	
+	// Makes a copy of this path, with 'node' recolored to 'nColor'.
+	// Assumes the move is valid (the node exists, and changes color).
+	Path makeMove(int node, int nColor) {
+		MemScope scope(MemTag::Paths);
+		Path nPath(*this); // Copy the existing setup.
+		nPath.colorCounts.dec(nPath.state.colors[node]); // Decrement color count for color.
+		nPath.colorCounts.inc(nColor); // Increment color count for color.
+		nPath.state.colors[node] = nColor; // Change node color.
+		nPath.movesMade += 1; // One more move made.
+		// Record the move, using any original zone that is part of 'node'.
+		for (int i = 0; i < initialNodeCount; i++) {
+			if (nPath.progress[i] != node) continue;
+			Move m;
+			m.zone = i;
+			m.x = m.y = -1; // Filled in from the zone map later.
+			m.color = nColor;
+			nPath.moves = make_shared<LinkedList<Move>>(m,nPath.moves);
+			break;
+		}
+		Remapper reduction; // Remaps the node numbers.
+		// Find nodes to combine, and populate 'reduction'
+		vInt toMerge; // A list of nodes to merge with 'node'
+		for (int node2 = 0; node2 < state.nodeCount; node2++) {
+			// If the nodes should be merged.
+			if (node != node2 and
+				state.colors[node2] == nPath.state.colors[node] and
+				state.adjacent[node].find(node2) != state.adjacent[node].end())
+			{
+				// Do nothing this pass; we do these at the end.
+				toMerge.push_back(node2);
+			} else {
+				// No merge, new node.
+				reduction.next(node2);
+			}
+		}
+		for (auto node2 : toMerge) {
+			reduction[node2] = reduction[node]; // Rename node.
+			// Reduce color count for merged nodes.
+			nPath.colorCounts.dec(nColor);
+		}
+		
+		
+		
+		// Apply reduction to graph.
+		nPath.state = reduction.reduce(nPath.state);
+		// Apply reduction to distance-tracking.
+		nPath.dists.reduce(reduction,reduction[node],nPath.state);
+		
+		
+		// track reductions, relative to initial state of board.
+		nPath.progress = nPath.progress.chain(reduction);
+		// Add an entry to 'history'
+		PackedColoring newHEntry(initialNodeCount,colorBits);
+		for (int i = 0; i < initialNodeCount; i++) {
+			// Add a new color entry, mapping from original zone #.
+			newHEntry.set(i,nPath.state.colors[nPath.progress[i]]);
+		}
+		// Update history. Since we are dealing with linked lists,
+		// we need to make a new node for each.
+		nPath.history = shared_ptr<LinkedList<PackedColoring>>(new LinkedList(newHEntry,nPath.history));
+		{
+			MemScope scope(MemTag::GraphHistory);
+			nPath.historyG = shared_ptr<LinkedList<graph>>(new LinkedList(nPath.state,nPath.historyG));
+		}
+		return nPath;
+	}
+	
+	// Same as makeMove, but takes an original zone # instead of a current node #.
+	Path makeZoneMove(int zone, int nColor) {
+		return makeMove(progress[zone],nColor);
+	}
+	
+	// Checks if recoloring an original zone is a legal move.
+	bool validZoneMove(int zone, int nColor) {
+		if (zone < 0 or zone >= initialNodeCount or nColor < 0) return false;
+		return state.colors[progress[zone]] != nColor;
+	}
+	
 	// Check if the search is complete.
 	bool done() const {return state.nodeCount == 1;}
 	
@@ -506,11 +814,36 @@ public:
 		return historyG->rVector();
 	}
 	
+	// The moves made, in order. Cell coordinates are left as -1.
+	vector<Move> zoneMoves() const {
+		if (moves == nullptr) return {};
+		return moves->rVector();
+	}
+	
+	// The moves made, in order, with cell coordinates taken from the zone map.
+	vector<Move> moveList(vector<vector<int>> & zoneMap) const {
+		vector<Move> result = zoneMoves();
+		for (auto & m : result) {
+			// The first cell of a zone (in reading order) is where genZones started filling it.
+			bool found = false;
+			for (uint y = 0; y < zoneMap.size() and !found; y++) {
+				for (uint x = 0; x < zoneMap[y].size(); x++) {
+					if (zoneMap[y][x] != m.zone) continue;
+					m.x = x;
+					m.y = y;
+					found = true;
+					break;
+				}
+			}
+		}
+		return result;
+	}
+	
 	// Takes a zone map, and returns a list of boards, each with the colors filled in.
 	vector<vector<vector<int>>> applyHistory(vector<vector<int>> zoneMap) const {
 		vector<vector<vector<int>>> result;
-		vector<vInt> myHistory = history->rVector();
-		for (auto cs : myHistory) {
+		vector<PackedColoring> myHistory = history->rVector();
+		for (auto & cs : myHistory) {
 			vector<vector<int>> nextBoard = zoneMap;
 			for (auto & row : nextBoard) {
 				for (auto & val : row) {
@@ -522,27 +855,98 @@ public:
 		return result;
 	}
 	
-	// A score for the quality of the run. Low score = good.
-	int score() const {
-		return moveCount() + state.nodeCount * state.nodeCount;
-	}
-	
-	// Compare to another Path. (used for a maxQueue)
-	bool operator < (Path other) const {
-		return score() > other.score();
-	}
+	// The number of nodes left in the graph.
+	int nodeCount() const {return state.nodeCount;}
 	
 	// Checks which one is superior ('done' always beats 'not done')
 	// True means 'other' is superior.
-	bool beaten(Path other) const {
+	bool beaten(const Path & other) const {
 		if (!other.done()) return false;
 		if (!done()) return true;
 		return moveCount() > other.moveCount();
 	}
 	
+	// A lower bound on the moves still needed: every color but one must go,
+	// and each move shrinks the greatest distance by at most 2.
+	int lowerBound() const {
+		return max(colorCounts.count() - 1, (dists.greatest() + 1) / 2);
+	}
+	
+	// The current color of each original zone.
+	const PackedColoring & coloring() const {return history->val;}
+	
+	// Packs a coloring of the original zones the same way as 'coloring'.
+	PackedColoring pack(const vInt & colors) const {return PackedColoring(colors,colorBits);}
+	
+	// The greatest distance from the node holding an original zone to any other node.
+	// Only a lower bound on boards big enough for DistTracker's landmark mode.
+	int eccentricity(int zone) {return dists.eccentricity(progress[zone]);}
+	
+	// Whether two original zones are now part of the same node.
+	bool sameNode(int zone, int other) {return progress[zone] == progress[other];}
+	
+	// The last move made. Only valid if moveCount() > 0.
+	Move lastMove() const {return moves->val;}
+	
+	int rank() const {return orderRank;}
+	void setRank(int rank) {orderRank = rank;}
+	
+	// A move, with what can be told of its child without building it.
+	struct MoveOption {
+		Move move; // By original zone. Cell coordinates are left as -1.
+		int bound; // Moves made plus a lower bound on the moves left. Can be below the child's own.
+		bool done; // Whether the move wins.
+	};
+	
+	// The moves 'followingStates' would try, with a bound for each from color counts and
+	// DistTracker::mergedBounds rather than from the child. Those that can't beat 'moveLimit' are left out.
+	vector<MoveOption> moveOptions(int moveLimit, Symmetries * symmetry = nullptr) {
+		vector<MoveOption> result;
+		if (moveLimit != -1 and movesMade + colorCounts.count() - 1 >= moveLimit) return result;
+		vInt distBound = dists.mergedBounds();
+		vector<bool> keep;
+		if (symmetry != nullptr) {
+			vInt nodeOf(initialNodeCount);
+			for (int zone = 0; zone < initialNodeCount; zone++) nodeOf[zone] = progress[zone];
+			keep = symmetricKeep(*symmetry,history->val.unpack(),nodeOf,state.nodeCount);
+		}
+		vInt zones = zoneOfNodes();
+		unordered_map<int,int> neighbors; // Neighbors of each color.
+		for (int node = 0; node < state.nodeCount; node++) {
+			neighbors.clear();
+			for (int node2 : state.adjacent[node]) neighbors[state.colors[node2]]++;
+			if (symmetry != nullptr) {
+				symmetry->considered += neighbors.size();
+				if (!keep[node]) {
+					symmetry->pruned += neighbors.size();
+					continue;
+				}
+			}
+			// The node's own color is gone after the move if it is the last of it.
+			int colorsLeft = colorCounts.count() - (colorCounts[state.colors[node]] == 1 ? 1 : 0);
+			for (auto & entry : neighbors) {
+				bool done = entry.second == state.nodeCount - 1;
+				int bound = movesMade + 1 + (done ? 0 : max(colorsLeft - 1,(distBound[node] + 1) / 2));
+				if (moveLimit != -1 and bound >= moveLimit) continue;
+				result.push_back({Move{zones[node],-1,-1,entry.first},bound,done});
+			}
+		}
+		return result;
+	}
+	
+	// The board as it is now.
+	const graph & current() const {return state;}
+	
+	// An original zone in each node of the board as it is now.
+	vInt zoneOfNodes() {
+		vInt res(state.nodeCount,-1);
+		for (int zone = initialNodeCount - 1; zone >= 0; zone--) res[progress[zone]] = zone;
+		return res;
+	}
+	
 	// Gives the 'fingerprint'. If two paths have the same fingerprint, then
 	// they will have the same following states.
-	pair<int,vInt> fingerprint() {
+	pair<int,PackedColoring> fingerprint() {
 		return {movesMade,history->val};
 	}
 	
@@ -551,197 +955,2092 @@ public:
 	}
 };
 
-// An improved priority_queue.
-// Extends priority_queue<Path> by enforcing that a path cannot be added if another path
-// reached the same coloring in the same or fewer moves.
-class priority_queue_Path {
-	priority_queue<Path> q; // The internal queue.
-	map<vInt,int> bestSoFar; // For each state, the best move-count to reach it.
-public:
-	// push: needed from priority_queue
-	void push(Path p) {
-		pair<int,vInt> fp = p.fingerprint();
-		int moves = fp.first;
-		vInt state = fp.second;
-		if (bestSoFar.find(state) != bestSoFar.end()) {
-			// Another path already reached this state.
-			// Check if they reached it faster.
-			if (bestSoFar[state] <= moves) {
-				// cout << "discarded!\n";
-				return;
-			}
-		}
-		bestSoFar[state] = moves; // Update best path.
-		q.push(p);
-	}
+// Orders the children of a path so the most promising are searched first: the killer move
+// for the depth, then moves leaving the moved node central (low eccentricity), then moves that
+// grow the node recolored last, then moves with the most history.
+// History and killers are by original zone and color, since node numbers change as nodes merge.
+// The engines decide what earns history, and what makes a killer.
+class MoveOrdering {
+protected:
+	int colors;
+	vector<unsigned long> history; // By zone and color.
+	vector<pair<int,int>> killers; // By depth: a (zone, color) that did well there last time.
 	
-	// pop: works better than priority_queue version
-	Path pop() {
-		Path res = q.top();
-		q.pop();
-		return res;
-	}
+	int index(const Move & m) const {return m.zone * colors + m.color;}
+	
+public:
+	MoveOrdering(int zones, int colors) : colors(colors), history(zones * colors,0) {}
+	MoveOrdering(graph & g) : MoveOrdering(g.nodeCount,colorLimit(g)) {}
+	// Later moves only use colors already on the board.
+	MoveOrdering(const Path & start) : MoveOrdering(start.coloring().size(),colorLimit(start.coloring().unpack())) {}
 	
+	void reward(const Move & m, unsigned long amount) {history[index(m)] += amount;}
 	
-	// size: needed from priority_queue
-	size_t size() {
-		return q.size();
+	// Makes 'm' the first move tried at 'depth' (the moves made before it), wherever it is legal.
+	void setKiller(const Move & m, int depth) {
+		if ((int)killers.size() <= depth) killers.resize(depth + 1,{-1,-1});
+		killers[depth] = {m.zone,m.color};
 	}
 	
-	
+	void sort(Path & parent, vector<Path> & children) {
+		int depth = parent.moveCount();
+		pair<int,int> killer = depth < (int)killers.size() ? killers[depth] : make_pair(-1,-1);
+		// (killer, eccentricity, grows the last node, -history), with lower first.
+		vector<tuple<bool,int,bool,long,int>> keys;
+		for (int i = 0; i < (int)children.size(); i++) {
+			Path & c = children[i];
+			Move m = c.lastMove();
+			bool grows = depth > 0 and c.sameNode(parent.lastMove().zone,m.zone);
+			bool isKiller = killer.first == m.zone and killer.second == m.color;
+			keys.push_back({!isKiller,c.eccentricity(m.zone),!grows,-(long)history[index(m)],i});
+		}
+		std::sort(keys.begin(),keys.end());
+		vector<Path> sorted;
+		sorted.reserve(children.size());
+		for (auto & k : keys) {
+			sorted.push_back(move(children[get<4>(k)]));
+			sorted.back().setRank(sorted.size() - 1);
+		}
+		children = move(sorted);
+	}
 };
 
+// Search policies for the best-first engine.
+// searchBestFirst is a template over a strategy, which names one policy of each kind:
+//   Open: the open list, ordered by a heuristic. 'push', 'pop', 'size' and 'forEach' (in no particular
+//     order, for checkpoints), built from the SolveOptions.
+//     If 'bounded' is set, it also has 'lowerBound()': the least moves made plus lower bound of any
+//     path in it. The search then stops once its solution is within 'epsilon' of that.
+//   Dedup: duplicate detection. 'admit(Path &)' returns false for paths not worth searching.
+//     'forEach' and 'restore' go through and refill its table of colorings and move counts.
+//   Prune: 'keep(Path &, int maxSol)' returns false for children that can't beat 'maxSol'.
+// A heuristic is 'static long score(const Path &)'. Lower scores are searched first.
+// Ties go to the path MoveOrdering ranked higher among its siblings (see Path::rank), with 'orderMoves'.
+// The strategy is picked once per search (see 'Strategy'), so the loop itself has no runtime checks.
 
-Path pop(priority_queue_Path & q) {
-	return q.pop();
-}
+// Few nodes first, then few moves. The original ordering.
+struct ClassicScore {
+	static long score(const Path & p) {
+		return p.moveCount() + (long)p.nodeCount() * p.nodeCount();
+	}
+};
 
-// Takes a blank (-1 populated) 'zones' board, a 'colors' board,
-// an x,y, and zoneNum.
-// Fills the area of the 'zones' board which corresponds to the given zone in 'colors'
-void floodZone(board& zones, board& colors, uint x, uint y, uint zoneNum) {
-	uint width = zones[0].size();
-	uint height = zones.size();
-	queue<int> xs;
-	queue<int> ys;
-	xs.push(x);
-	ys.push(y);
-	int color = colors[y][x]; // The color to flood.
-	while (xs.size() != 0) {
-		x = pop(xs);
-		y = pop(ys);
-		if (zones[y][x] != -1) continue;
-		if (colors[y][x] != color) continue;
-		zones[y][x] = zoneNum;
-		if (x > 0) {
-			xs.push(x-1);
-			ys.push(y);
-		}
-		if (y > 0) {
-			xs.push(x);
-			ys.push(y-1);
-		}
-		if (x < width - 1) {
-			xs.push(x+1);
-			ys.push(y);
-		}
-		if (y < height - 1) {
-			xs.push(x);
-			ys.push(y+1);
+// A*: fewest moves made plus moves still needed, then fewest nodes.
+struct AStarScore {
+	static long score(const Path & p) {
+		return (long)(p.moveCount() + p.lowerBound()) * 1000000 + p.nodeCount();
+	}
+};
+
+// Fewest moves still needed, ignoring moves made.
+struct GreedyScore {
+	static long score(const Path & p) {
+		return (long)p.lowerBound() * 1000000 + p.nodeCount();
+	}
+};
+
+// A priority queue of paths that can also be looked through.
+template <class Worse>
+class PathHeap : public priority_queue<Path,vector<Path>,Worse> {
+public:
+	using priority_queue<Path,vector<Path>,Worse>::priority_queue;
+	const vector<Path> & items() const {return this->c;}
+};
+
+// A binary heap ordered by a heuristic.
+template <class Heuristic>
+class HeapOpenList {
+	struct Worse {
+		bool operator()(const Path & a, const Path & b) const {
+			long scoreA = Heuristic::score(a);
+			long scoreB = Heuristic::score(b);
+			if (scoreA != scoreB) return scoreA > scoreB;
+			return a.rank() > b.rank();
 		}
+	};
+	PathHeap<Worse> q;
+public:
+	static const bool bounded = false;
+	HeapOpenList(SolveOptions &) {}
+	// Takes over the contents of 'p'.
+	void push(Path & p) {
+		MemScope scope(MemTag::Paths);
+		q.push(move(p));
 	}
-}
+	Path pop() {
+		MemScope scope(MemTag::Paths);
+		Path res = q.top();
+		q.pop();
+		return res;
+	}
+	size_t size() const {return q.size();}
+	template <class F> void forEach(F f) const {
+		for (auto & p : q.items()) f(p);
+	}
+};
 
-// Takes a board (of colors), returns a board (of zones)
-board genZones(board rawInput, int& zoneCount, vector<int> & zoneColors) {
-	// Generate a blank board.
-	board result = rawInput;
-	// Clear board
-	for (auto& row : result) {
-		for (auto& val : row) {
-			val = -1;
+// A bucket queue: one list of paths per f (moves made plus lower bound), searched lowest f first.
+// f is a small int, so finding the next path is a step along an array rather than a heap sift.
+// Paths stay where they were pushed, in a pool; the buckets hold their slot numbers. With 'Deepest',
+// each bucket is split again by moves made, and the most moves made (then the last in) goes first.
+class BucketOpenList {
+	typedef deque<int> Slots;
+	vector<Path> pool;
+	vInt freeSlots;
+	vector<vector<Slots>> buckets; // By f, then by moves made (or just [0], if not 'Deepest').
+	size_t lowest = 0; // No bucket below this has anything in it.
+	size_t count = 0;
+	TieBreak tieBreak;
+public:
+	static const bool bounded = false;
+	BucketOpenList(SolveOptions & options) : tieBreak(options.tieBreak) {}
+	// Takes over the contents of 'p'.
+	void push(Path & p) {
+		MemScope scope(MemTag::Paths);
+		size_t f = p.moveCount() + p.lowerBound();
+		size_t sub = tieBreak == TieBreak::Deepest ? p.moveCount() : 0;
+		if (f >= buckets.size()) buckets.resize(f + 1);
+		if (sub >= buckets[f].size()) buckets[f].resize(sub + 1);
+		int slot;
+		if (freeSlots.size() > 0) {
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+			pool[slot] = move(p);
+		} else {
+			slot = pool.size();
+			pool.push_back(move(p));
 		}
+		buckets[f][sub].push_back(slot);
+		if (count == 0 or f < lowest) lowest = f;
+		count++;
 	}
-	uint height = result.size();
-	uint width = result[0].size();
-	int zoneNum = 0; // A counter for next free zone#
-	for (uint y = 0; y < height; y++) {
-		for (uint x = 0; x < width; x++) {
-			if (result[y][x] == -1) {
-				zoneColors.push_back(rawInput[y][x]);
-				floodZone(result,rawInput,x,y,zoneNum++);
+	Path pop() {
+		MemScope scope(MemTag::Paths);
+		while (true) {
+			auto & bucket = buckets[lowest];
+			for (int sub = bucket.size() - 1; sub >= 0; sub--) {
+				Slots & slots = bucket[sub];
+				if (slots.size() == 0) continue;
+				int slot;
+				if (tieBreak != TieBreak::Fifo) {
+					slot = slots.back();
+					slots.pop_back();
+				} else {
+					slot = slots.front();
+					slots.pop_front();
+				}
+				count--;
+				freeSlots.push_back(slot);
+				return move(pool[slot]);
 			}
+			lowest++;
 		}
 	}
-	zoneCount = zoneNum;
-	return result;
-}
-
-graph genGraph(board zones, int zoneCount, vector<int> zoneColors) {
-	graph res;
-	res.nodeCount = zoneCount;
-	res.colors = zoneColors;
-	for (int i = 0; i < zoneCount; i++) res.adjacent[i] = unordered_set<int>();
-	uint height = zones.size();
-	uint width = zones[0].size();
-	for (uint y = 0; y < height; y++) {
-		for (uint x = 0; x < width; x++) {
-			if (x > 0 and zones[y][x] != zones[y][x-1]) {
-				res.adjacent[zones[y][x]].insert(zones[y][x-1]);
-				res.adjacent[zones[y][x-1]].insert(zones[y][x]);
-			}
-			if (y > 0 and zones[y][x] != zones[y-1][x]) {
-				res.adjacent[zones[y][x]].insert(zones[y-1][x]);
-				res.adjacent[zones[y-1][x]].insert(zones[y][x]);
+	size_t size() const {return count;}
+	template <class F> void forEach(F f) const {
+		for (auto & bucket : buckets) {
+			for (auto & slots : bucket) {
+				for (int slot : slots) f(pool[slot]);
 			}
-			// Only check above and left, since insertion is bidirectional.
 		}
 	}
-	return res;
+};
+
+// Weight times 1000, for solutions at most 'epsilon' longer than optimal.
+long weightOf(SolveOptions & options) {
+	return lround((1 + max(0.0,options.epsilon)) * 1000);
 }
 
+// Counts of the moves made plus lower bound (f) of the paths in an open list.
+class FTally {
+	map<int,size_t> counts;
+public:
+	void add(const Path & p) {counts[p.moveCount() + p.lowerBound()]++;}
+	void remove(const Path & p) {
+		auto found = counts.find(p.moveCount() + p.lowerBound());
+		if (--found->second == 0) counts.erase(found);
+	}
+	int least() const {return counts.size() == 0 ? INT_MAX : counts.begin()->first;}
+};
 
-// Solves the problem, and returns results to the '&' parameters.
-// The boolean result is 'true' unless it times out.
-bool solve(graph startingPoint, vector<vector<int>> zoneMap, vector<vector<vector<int>>> & result1, vector<graph> & result2, uint maxTime, uint & iterations, int minSol, int maxSol) {
-	bool fullSearch = true;
-	bool showCount = (iterations == 1);
-	priority_queue_Path q;
-	// priority_queue<Path> q;
-	Path best;
-	q.push(Path(startingPoint));
-	clock_t start;
-	if (maxTime) start = clock();
-	clock_t cMaxTime = maxTime * CLOCKS_PER_SEC;
-	// Do the search.
-	uint iterCount = 0;
-	while (q.size() > 0) {
-		iterCount++;
-		if (maxTime != 0 and clock() - start > cMaxTime) {
-			fullSearch = false;
-			break;
+// Weighted A*: a heap ordered by moves made plus 'weight' times the lower bound.
+// Also tallies the unweighted sums, for the proven lower bound.
+class WeightedOpenList {
+	struct Worse {
+		long weight;
+		long score(const Path & p) const {
+			return ((long)p.moveCount() * 1000 + weight * p.lowerBound()) * 1000000 + p.nodeCount();
 		}
-		Path p = pop(q);
-		// update best, if needed
-		if (best.beaten(p)) {
-			best = p;
-			if (showCount) cout << "Found new solution: " << p.moveCount() << " moves.\n";
-			maxSol = p.moveCount(); // Update pruning distance.
-			if (maxSol <= minSol) break; // If we have reached an optimal solution, finish.
+		bool operator()(const Path & a, const Path & b) const {
+			long scoreA = score(a);
+			long scoreB = score(b);
+			if (scoreA != scoreB) return scoreA > scoreB;
+			return a.rank() > b.rank();
 		}
-		// If a solution has already been found, trim invalid solutions.
-		if (maxSol >= 0 and p.moveCount() + 1 >= maxSol) continue;
+	};
+	PathHeap<Worse> q;
+	FTally tally;
+public:
+	static const bool bounded = true;
+	WeightedOpenList(SolveOptions & options) : q(Worse{weightOf(options)}) {}
+	// Takes over the contents of 'p'.
+	void push(Path & p) {
+		MemScope scope(MemTag::Paths);
+		tally.add(p);
+		q.push(move(p));
+	}
+	Path pop() {
+		MemScope scope(MemTag::Paths);
+		Path res = q.top();
+		q.pop();
+		tally.remove(res);
+		return res;
+	}
+	size_t size() const {return q.size();}
+	template <class F> void forEach(F f) const {
+		for (auto & p : q.items()) f(p);
+	}
+	int lowerBound() const {return tally.least();}
+};
+
+// Focal search: paths are kept in buckets by moves made plus lower bound (f). The 'focal' list is
+// every bucket within 'weight' times the least f, and from it the path with fewest nodes
+// (then most moves) is searched first, like the classic ordering.
+class FocalOpenList {
+	struct Worse {
+		bool operator()(const Path & a, const Path & b) const {
+			if (a.nodeCount() != b.nodeCount()) return a.nodeCount() > b.nodeCount();
+			if (a.moveCount() != b.moveCount()) return a.moveCount() < b.moveCount();
+			return a.rank() > b.rank();
+		}
+	};
+	map<int,PathHeap<Worse>> buckets;
+	long weight;
+	size_t count = 0;
+public:
+	static const bool bounded = true;
+	FocalOpenList(SolveOptions & options) : weight(weightOf(options)) {}
+	// Takes over the contents of 'p'.
+	void push(Path & p) {
+		MemScope scope(MemTag::Paths);
+		int f = p.moveCount() + p.lowerBound();
+		buckets[f].push(move(p));
+		count++;
+	}
+	Path pop() {
+		MemScope scope(MemTag::Paths);
+		long limit = buckets.begin()->first * weight / 1000;
+		auto best = buckets.begin();
+		for (auto it = buckets.begin(); it != buckets.end() and it->first <= limit; it++) {
+			if (Worse()(best->second.top(),it->second.top())) best = it;
+		}
+		Path res = best->second.top();
+		best->second.pop();
+		if (best->second.size() == 0) buckets.erase(best);
+		count--;
+		return res;
+	}
+	size_t size() const {return count;}
+	template <class F> void forEach(F f) const {
+		for (auto & bucket : buckets) {
+			for (auto & p : bucket.second.items()) f(p);
+		}
+	}
+	int lowerBound() const {return buckets.size() == 0 ? INT_MAX : buckets.begin()->first;}
+};
+
+// Rejects a path if another path reached the same coloring in the same or fewer moves.
+// 'Map' is the map type from colorings to move counts.
+template <class Map>
+class BestDepthDedup {
+	Map bestSoFar; // For each state, the best move-count to reach it.
+public:
+	bool admit(Path & p) {
+		MemScope scope(MemTag::Dedup);
+		const PackedColoring & state = p.coloring();
+		auto found = bestSoFar.find(state);
+		if (found != bestSoFar.end()) {
+			// Another path already reached this state.
+			// Check if they reached it faster.
+			if (found->second <= p.moveCount()) return false;
+			found->second = p.moveCount(); // Update best path.
+			return true;
+		}
+		bestSoFar[state] = p.moveCount();
+		return true;
+	}
+	size_t size() const {return bestSoFar.size();}
+	template <class F> void forEach(F f) const {
+		for (auto & entry : bestSoFar) f(entry.first,entry.second);
+	}
+	void restore(const PackedColoring & state, int moveCount) {
+		MemScope scope(MemTag::Dedup);
+		bestSoFar[state] = moveCount;
+	}
+};
+
+typedef BestDepthDedup<map<PackedColoring,int>> OrderedDedup;
+typedef BestDepthDedup<unordered_map<PackedColoring,int,PackedColoringHash>> HashedDedup;
+
+// Only the pruning done by followingStates.
+struct LimitPrune {
+	static bool keep(Path &, int) {return true;}
+};
+
+// Also drops children whose lower bound already reaches the best solution.
+struct BoundPrune {
+	static bool keep(Path & p, int maxSol) {
+		return maxSol == -1 or p.done() or p.moveCount() + p.lowerBound() < maxSol;
+	}
+};
+
+// Presets, one per 'Strategy'.
+struct ClassicStrategy {
+	typedef HeapOpenList<ClassicScore> Open;
+	typedef OrderedDedup Dedup;
+	typedef LimitPrune Prune;
+};
+
+struct AStarStrategy {
+	typedef HeapOpenList<AStarScore> Open;
+	typedef HashedDedup Dedup;
+	typedef BoundPrune Prune;
+};
+
+struct GreedyStrategy {
+	typedef HeapOpenList<GreedyScore> Open;
+	typedef HashedDedup Dedup;
+	typedef BoundPrune Prune;
+};
+
+struct LeanStrategy {
+	typedef HeapOpenList<ClassicScore> Open;
+	typedef HashedDedup Dedup;
+	typedef BoundPrune Prune;
+};
+
+struct BucketStrategy {
+	typedef BucketOpenList Open;
+	typedef HashedDedup Dedup;
+	typedef BoundPrune Prune;
+};
+
+struct WeightedStrategy {
+	typedef WeightedOpenList Open;
+	typedef HashedDedup Dedup;
+	typedef BoundPrune Prune;
+};
+
+struct FocalStrategy {
+	typedef FocalOpenList Open;
+	typedef HashedDedup Dedup;
+	typedef BoundPrune Prune;
+};
+
+// Counts the solutions of exactly 'length' moves, memoized by fingerprint (move count and coloring).
+// Two paths with the same fingerprint have the same number of ways to finish, so each state's
+// subtree is only searched once, however many move orders reach it.
+class SolutionCounter {
+protected:
+	int length;
+	SolveOptions & options;
+	vector<vector<int>> & zoneMap;
+	map<pair<int,PackedColoring>,unsigned long long> counts; // Ways to finish from each state. 0 for dead ends.
+	uint examples; // Solutions still to report.
+	function<void(const vector<Move> &)> onSolution;
+	chrono::steady_clock::time_point start;
+	bool limited = false;
+	
+	static unsigned long long add(unsigned long long a, unsigned long long b) {
+		return a > ULLONG_MAX - b ? ULLONG_MAX : a + b; // Saturates, rather than wrapping.
+	}
+	
+	bool outOfLimits() {
+		if (options.maxNodes != 0 and iterations >= options.maxNodes) return true;
+		if (options.maxTime != 0 and chrono::steady_clock::now() - start > chrono::seconds(options.maxTime)) return true;
+		return false;
+	}
+	
+	// The children that can still finish in time.
+	vector<Path> children(Path & p) {
+		vector<Path> res;
+		for (Path & child : p.followingStates(length + 1,true)) {
+			if (child.done() ? child.moveCount() != length : child.moveCount() + child.lowerBound() > length) continue;
+			res.push_back(child);
+		}
+		return res;
+	}
+	
+	void report(Path & p) {
+		if (examples == 0) return;
+		examples--;
+		if (onSolution) onSolution(p.moveList(zoneMap));
+	}
+	
+	// Reports solutions through a state that has already been counted.
+	void reportFrom(Path & p) {
+		if (p.done()) {
+			report(p);
+			return;
+		}
+		for (Path & child : children(p)) {
+			if (examples == 0) return;
+			auto found = counts.find(child.fingerprint());
+			if (child.done() or (found != counts.end() and found->second > 0)) reportFrom(child);
+		}
+	}
+	
+	unsigned long long count(Path & p) {
+		if (p.done()) {
+			report(p);
+			return 1;
+		}
+		auto found = counts.find(p.fingerprint());
+		if (found != counts.end()) {
+			if (found->second > 0 and examples > 0) reportFrom(p);
+			return found->second;
+		}
+		if (limited or outOfLimits()) {
+			limited = true;
+			return 0;
+		}
+		iterations++;
+		unsigned long long res = 0;
+		for (Path & child : children(p)) res = add(res,count(child));
+		if (!limited) counts[p.fingerprint()] = res; // A partial count must not be reused.
+		return res;
+	}
+	
+public:
+	unsigned long iterations = 0;
+	
+	SolutionCounter(int length, SolveOptions & options, vector<vector<int>> & zoneMap, uint examples, function<void(const vector<Move> &)> onSolution) :
+		length(length), options(options), zoneMap(zoneMap), examples(examples), onSolution(onSolution) {}
+	
+	// Returns false if stopped by a time or node limit.
+	bool run(graph & g, unsigned long long & solutions) {
+		start = chrono::steady_clock::now();
+		Path root(g);
+		solutions = count(root);
+		return !limited;
+	}
+};
+
+// Builds the graph for a coloring of the original zones, merging adjacent zones of the same color.
+// 'zoneToNode' maps each original zone to its new node, and 'nodeToZone' maps each new node
+// to one of its original zones.
+graph colorQuotient(graph & original, const vInt & colors, vInt & zoneToNode, vInt & nodeToZone) {
+	graph res;
+	res.nodeCount = 0;
+	zoneToNode.assign(original.nodeCount,-1);
+	nodeToZone.clear();
+	for (int zone = 0; zone < original.nodeCount; zone++) {
+		if (zoneToNode[zone] != -1) continue;
+		int node = res.nodeCount++;
+		res.colors.push_back(colors[zone]);
+		nodeToZone.push_back(zone);
+		res.adjacent[node];
+		// Flood through same-colored neighbors.
+		queue<int> toVisit;
+		toVisit.push(zone);
+		zoneToNode[zone] = node;
+		while (toVisit.size() > 0) {
+			int z = pop(toVisit);
+			for (int other : original.adjacent[z]) {
+				if (zoneToNode[other] != -1 or colors[other] != colors[zone]) continue;
+				zoneToNode[other] = node;
+				toVisit.push(other);
+			}
+		}
+	}
+	for (int zone = 0; zone < original.nodeCount; zone++) {
+		for (int other : original.adjacent[zone]) {
+			int a = zoneToNode[zone];
+			int b = zoneToNode[other];
+			if (a != b) res.adjacent[a].insert(b);
+		}
+	}
+	return res;
+}
+
+// A search that keeps its frontier on disk, for boards whose frontier does not fit in memory.
+// It is breadth-first iterative deepening: for each bound F on f = g + h (from the root's lower bound upwards),
+// it searches breadth-first, one depth layer at a time, discarding any state with f > F.
+// Each layer is a file of fixed-size records, sorted by state.
+// Duplicates are found by sorting (in memory-sized runs, then merging) rather than with an in-memory map,
+// and states already seen at a shallower depth are removed by merging against a sorted 'closed' file.
+// Since no state can be reached again with fewer moves, the first solution found is optimal.
+class ExternalSearch {
+protected:
+	// A record is a packed coloring of the original zones, followed by the moves to reach it
+	// (2 bytes of zone and 1 byte of color each).
+	graph original;
+	SolveOptions & options;
+	uint keySize; // Bytes of packed coloring.
+	bool nibbles; // Whether colors are packed two per byte.
+	size_t memoryLimit; // Bytes of records to sort in memory at once.
+	string prefix; // The start of every temporary file name.
+	int nextFile = 0;
+	vector<string> files; // Every temporary file, for cleaning up.
+	chrono::steady_clock::time_point start;
+	
+	string newFile() {
+		string name = prefix + to_string(nextFile++);
+		files.push_back(name);
+		return name;
+	}
+	
+	string pack(const vInt & colors) {
+		string res(keySize,'\0');
+		for (uint i = 0; i < colors.size(); i++) {
+			if (nibbles) {
+				res[i/2] |= colors[i] << (4 * (i % 2));
+			} else {
+				res[i] = colors[i];
+			}
+		}
+		return res;
+	}
+	
+	vInt unpack(const string & rec) {
+		vInt res(original.nodeCount);
+		for (int i = 0; i < original.nodeCount; i++) {
+			if (nibbles) {
+				res[i] = (rec[i/2] >> (4 * (i % 2))) & 15;
+			} else {
+				res[i] = (unsigned char)rec[i];
+			}
+		}
+		return res;
+	}
+	
+	// Reads fixed-size records from a file, in order.
+	class Reader {
+	public:
+		ifstream file;
+		size_t size;
+		string rec;
+		bool valid = false;
+		Reader(string name, size_t size) : file(name,ios::binary), size(size), rec(size,'\0') {next();}
+		void next() {valid = static_cast<bool>(file.read(&rec[0],size));}
+	};
+	
+	bool keyLess(const string & a, const string & b) const {
+		return memcmp(a.data(),b.data(),keySize) < 0;
+	}
+	
+	bool keyEqual(const string & a, const string & b) const {
+		return memcmp(a.data(),b.data(),keySize) == 0;
+	}
+	
+	// Sorts a buffer of records and writes it as a run, dropping duplicate states.
+	void writeRun(vector<string> & buffer, vector<string> & runs) {
+		if (buffer.size() == 0) return;
+		sort(buffer.begin(),buffer.end(),[this](const string & a, const string & b) {return keyLess(a,b);});
+		string name = newFile();
+		ofstream out(name,ios::binary);
+		for (uint i = 0; i < buffer.size(); i++) {
+			if (i > 0 and keyEqual(buffer[i],buffer[i-1])) continue;
+			out.write(buffer[i].data(),buffer[i].size());
+		}
+		runs.push_back(name);
+		buffer.clear();
+	}
+	
+	// Merges sorted runs into one layer file, dropping duplicates and anything in 'closed'.
+	// Also writes the keys of the new layer merged into 'closed', as 'newClosed'.
+	// Returns the number of records in the layer.
+	unsigned long mergeRuns(vector<string> & runs, size_t recSize, string closed, string layer, string newClosed) {
+		vector<unique_ptr<Reader>> readers;
+		for (auto & name : runs) readers.push_back(make_unique<Reader>(name,recSize));
+		Reader closedReader(closed,keySize);
+		ofstream out(layer,ios::binary);
+		ofstream outClosed(newClosed,ios::binary);
+		string last;
+		unsigned long count = 0;
+		while (true) {
+			// Find the smallest record among the runs.
+			Reader * least = nullptr;
+			for (auto & r : readers) {
+				if (r->valid and (least == nullptr or keyLess(r->rec,least->rec))) least = r.get();
+			}
+			if (least == nullptr) break;
+			string rec = least->rec;
+			least->next();
+			if (last.size() > 0 and keyEqual(rec,last)) continue;
+			last = rec;
+			// Copy across closed states that come first.
+			while (closedReader.valid and keyLess(closedReader.rec,rec)) {
+				outClosed.write(closedReader.rec.data(),keySize);
+				closedReader.next();
+			}
+			if (closedReader.valid and keyEqual(closedReader.rec,rec)) continue; // Seen at a shallower depth.
+			out.write(rec.data(),recSize);
+			outClosed.write(rec.data(),keySize);
+			count++;
+		}
+		while (closedReader.valid) {
+			outClosed.write(closedReader.rec.data(),keySize);
+			closedReader.next();
+		}
+		for (auto & name : runs) remove(name.c_str());
+		return count;
+	}
+	
+	bool outOfLimits() {
+		if (options.maxNodes != 0 and iterations >= options.maxNodes) return true;
+		if (options.maxTime != 0 and chrono::steady_clock::now() - start > chrono::seconds(options.maxTime)) return true;
+		return false;
+	}
+	
+	// Searches with bound F. Returns 1 if solved, 0 if not, and -1 if stopped by a limit.
+	int searchBound(int bound) {
+		string layer = newFile();
+		string closed = newFile();
+		{
+			ofstream(layer,ios::binary) << pack(original.colors);
+			ofstream(closed,ios::binary) << pack(original.colors);
+		}
+		for (int g = 0; g < bound; g++) {
+			size_t recSize = keySize + 3 * g;
+			size_t childSize = recSize + 3;
+			vector<string> buffer;
+			vector<string> runs;
+			Reader parents(layer,recSize);
+			for (; parents.valid; parents.next()) {
+				if (outOfLimits()) return -1;
+				iterations++;
+				vInt zoneToNode;
+				vInt nodeToZone;
+				vInt parentColors = unpack(parents.rec);
+				graph g2 = colorQuotient(original,parentColors,zoneToNode,nodeToZone);
+				Path p(g2);
+				// The path's zones are nodes of g2, so symmetric moves are found against the original zones here.
+				vector<bool> keep;
+				if (symmetry != nullptr) keep = symmetricKeep(*symmetry,parentColors,zoneToNode,g2.nodeCount);
+				for (Path child : p.followingStates(bound - g + 1)) {
+					if (!child.done() and g + 1 + child.lowerBound() > bound) continue;
+					Move m = child.lastMove();
+					// A win comes back on its own, so it is kept even if symmetric.
+					if (symmetry != nullptr and !child.done()) {
+						symmetry->considered++;
+						if (!keep[m.zone]) {
+							symmetry->pruned++;
+							continue;
+						}
+					}
+					int zone = nodeToZone[m.zone]; // The path's zones are nodes of g2.
+					string rec = parents.rec;
+					rec += (char)(zone & 255);
+					rec += (char)(zone >> 8);
+					rec += (char)m.color;
+					// Expand the child's coloring back to the original zones.
+					const PackedColoring & nodeColors = child.coloring();
+					vInt colors(original.nodeCount);
+					for (int z = 0; z < original.nodeCount; z++) colors[z] = nodeColors[zoneToNode[z]];
+					rec.replace(0,keySize,pack(colors));
+					if (child.done()) {
+						readSolution(rec,g + 1);
+						return 1;
+					}
+					buffer.push_back(rec);
+					if (buffer.size() * (childSize + 32) > memoryLimit) writeRun(buffer,runs);
+				}
+			}
+			writeRun(buffer,runs);
+			string nextLayer = newFile();
+			string nextClosed = newFile();
+			unsigned long count = mergeRuns(runs,childSize,closed,nextLayer,nextClosed);
+			remove(layer.c_str());
+			remove(closed.c_str());
+			layer = nextLayer;
+			closed = nextClosed;
+			if (count == 0) break;
+		}
+		remove(layer.c_str());
+		remove(closed.c_str());
+		return 0;
+	}
+	
+	void readSolution(const string & rec, int moveCount) {
+		solution.clear();
+		for (int i = 0; i < moveCount; i++) {
+			size_t pos = keySize + 3 * i;
+			Move m;
+			m.zone = (unsigned char)rec[pos] | ((unsigned char)rec[pos+1] << 8);
+			m.color = (unsigned char)rec[pos+2];
+			m.x = m.y = -1;
+			solution.push_back(m);
+		}
+	}
+	
+public:
+	vector<Move> solution;
+	unsigned long iterations = 0;
+	Symmetries * symmetry = nullptr; // If set, symmetric moves are skipped.
+	
+	ExternalSearch(graph & original, SolveOptions & options) : original(original), options(options) {
+		nibbles = colorLimit(original) <= 16;
+		keySize = nibbles ? (original.nodeCount + 1) / 2 : original.nodeCount;
+		memoryLimit = options.memoryLimit * 1024 * 1024;
+		prefix = options.spillDir + "/kamiSolver-" + to_string(getpid()) + "-" + to_string((uintptr_t)this) + "-";
+	}
+	
+	~ExternalSearch() {
+		for (auto & name : files) remove(name.c_str());
+	}
+	
+	// Returns false if stopped by a time or node limit.
+	bool run() {
+		start = chrono::steady_clock::now();
+		solution.clear();
+		if (original.nodeCount == 1) return true;
+		int bound = Path(original).lowerBound();
+		for (; options.maxSol == -1 or bound < options.maxSol; bound++) {
+			if (options.showCount) cout << "Searching for solutions of " << bound << " moves.\n";
+			int res = searchBound(bound);
+			if (res == -1) return false;
+			if (res == 1) return true;
+		}
+		return true;
+	}
+	
+	// Checks if the zone numbers and colors fit in a record.
+	static bool fits(graph & g) {
+		return g.nodeCount <= 65536 and colorLimit(g) <= 256;
+	}
+};
+
+// Depth-first iterative deepening, split across threads.
+// Each worker keeps a stack of sibling lists, and works from the deepest one.
+// Idle workers steal from the shallowest list of another worker instead,
+// since those moves have the largest subtrees left to search.
+class ParallelSearch {
+protected:
+	// The children of one path on a worker's stack, not yet searched.
+	struct Frame {
+		vector<Path> children;
+		size_t next = 0; // The owner takes children from the front, thieves from the back.
+	};
+	struct Worker {
+		mutex lock;
+		vector<Frame> stack;
+		unique_ptr<MoveOrdering> ordering; // Only with 'orderMoves'. Each worker learns its own.
+	};
+	graph original;
+	SolveOptions & options;
+	uint threadCount;
+	vector<unique_ptr<Worker>> workers;
+	atomic<int> busy; // Workers with paths to search. Once 0, the bound has been searched fully.
+	atomic<bool> stop; // Set once a solution is found, or a limit is reached.
+	atomic<bool> limited; // Set if a limit was reached.
+	atomic<unsigned long> count;
+	mutex solutionLock;
+	bool solved = false;
+	chrono::steady_clock::time_point start;
+	
+	// Takes the next child from the worker's deepest frame. Returns false once its stack is empty.
+	bool takeOwn(Worker & w, Path & p) {
+		lock_guard<mutex> guard(w.lock);
+		while (w.stack.size() > 0) {
+			Frame & f = w.stack.back();
+			if (f.next < f.children.size()) {
+				p = move(f.children[f.next++]);
+				return true;
+			}
+			w.stack.pop_back();
+		}
+		return false;
+	}
+	
+	// Takes the last child from the shallowest non-empty frame of another worker.
+	bool steal(uint thief, Path & p) {
+		for (uint i = 1; i < threadCount; i++) {
+			Worker & victim = *workers[(thief + i) % threadCount];
+			lock_guard<mutex> guard(victim.lock);
+			for (Frame & f : victim.stack) {
+				if (f.next == f.children.size()) continue;
+				p = move(f.children.back());
+				f.children.pop_back();
+				busy++; // Before the victim can finish, so 'busy' never drops to 0 early.
+				return true;
+			}
+		}
+		return false;
+	}
+	
+	bool outOfLimits(unsigned long n) {
+		if (options.maxNodes != 0 and n > options.maxNodes) return true;
+		if (options.maxTime != 0 and chrono::steady_clock::now() - start > chrono::seconds(options.maxTime)) return true;
+		return false;
+	}
+	
+	// Pushes the children of 'p' that can still finish within 'bound' moves.
+	void expand(Worker & w, Path & p, int bound) {
+		unsigned long n = ++count;
+		if (outOfLimits(n)) {
+			count--; // This one was not processed.
+			limited = true;
+			stop = true;
+			return;
+		}
+		Frame f;
+		for (Path & child : p.followingStates(bound + 1,false,symmetry)) {
+			if (child.done()) {
+				lock_guard<mutex> guard(solutionLock);
+				if (!solved) solution = child.zoneMoves();
+				solved = true;
+				stop = true;
+				return;
+			}
+			if (child.moveCount() + child.lowerBound() > bound) continue;
+			f.children.push_back(move(child));
+		}
+		if (f.children.size() == 0) return;
+		if (w.ordering) {
+			// The move that led here wasn't a dead end. Deeper ones count for more.
+			// Only history: that alone is too weak a sign to make it the killer.
+			if (p.moveCount() > 0) w.ordering->reward(p.lastMove(),p.moveCount() * p.moveCount());
+			w.ordering->sort(p,f.children);
+		}
+		lock_guard<mutex> guard(w.lock);
+		w.stack.push_back(move(f));
+	}
+	
+	void work(uint id, int bound) {
+		Worker & w = *workers[id];
+		bool holding = (id == 0); // Worker 0 starts with the root.
+		Path p;
+		while (!stop) {
+			if (!takeOwn(w,p)) {
+				if (holding) busy--;
+				holding = false;
+				if (busy == 0) return;
+				if (!steal(id,p)) {
+					this_thread::yield();
+					continue;
+				}
+				holding = true;
+			}
+			expand(w,p,bound);
+		}
+	}
+	
+public:
+	vector<Move> solution;
+	unsigned long iterations = 0;
+	Symmetries * symmetry = nullptr; // If set, symmetric moves are skipped.
+	
+	ParallelSearch(graph & original, SolveOptions & options) : original(original), options(options) {
+		threadCount = options.threads;
+		if (threadCount == 0) threadCount = max(1u,thread::hardware_concurrency());
+		for (uint i = 0; i < threadCount; i++) {
+			workers.push_back(make_unique<Worker>());
+			if (options.orderMoves) workers.back()->ordering = make_unique<MoveOrdering>(original);
+		}
+	}
+	
+	// Returns false if stopped by a time or node limit.
+	bool run() {
+		start = chrono::steady_clock::now();
+		solution.clear();
+		count = 0;
+		limited = false;
+		if (original.nodeCount == 1) return true;
+		Path root(original);
+		for (int bound = root.lowerBound(); options.maxSol == -1 or bound < options.maxSol; bound++) {
+			if (options.showCount) cout << "Searching for solutions of " << bound << " moves.\n";
+			for (auto & w : workers) w->stack.clear();
+			Frame f;
+			f.children.push_back(root);
+			workers[0]->stack.push_back(f);
+			busy = 1;
+			stop = false;
+			vector<thread> threads;
+			for (uint i = 0; i < threadCount; i++) threads.emplace_back(&ParallelSearch::work,this,i,bound);
+			for (auto & t : threads) t.join();
+			iterations = count;
+			if (solved) return true;
+			if (limited) return false;
+		}
+		return true;
+	}
+};
+
+// A board for Monte Carlo playouts: only colors and adjacency, changed in place. Merged nodes keep
+// their numbers and simply stop being alive, so moves are by node of the board it started from.
+// With no distances or history to update, a move only touches the nodes it merges and their neighbors.
+class Playout {
+	vInt colors;
+	vector<vInt> adjacent; // Between live nodes only.
+	vector<bool> alive;
+	IntMultiSet colorCounts;
+	int live;
+public:
+	vector<pair<int,int>> moves; // (node, color), in order.
+	
+	Playout(const graph & g) : colors(g.colors), adjacent(g.nodeCount), alive(g.nodeCount,true), colorCounts(colorLimit(g.colors)), live(g.nodeCount) {
+		for (auto & entry : g.adjacent) adjacent[entry.first].assign(entry.second.begin(),entry.second.end());
+		colorCounts.tally(colors);
+	}
+	
+	bool done() const {return live == 1;}
+	
+	// Every color but one must go.
+	int lowerBound() const {return colorCounts.count() - 1;}
+	
+	// Recolors 'node', merging it with its neighbors of color 'nColor'.
+	void makeMove(int node, int nColor) {
+		moves.push_back({node,nColor});
+		colorCounts.dec(colors[node]);
+		colorCounts.inc(nColor);
+		colors[node] = nColor;
+		vInt merged;
+		for (int other : adjacent[node]) {
+			if (colors[other] == nColor) merged.push_back(other);
+		}
+		vInt & adj = adjacent[node];
+		for (int u : merged) {
+			colorCounts.dec(nColor);
+			alive[u] = false;
+			live--;
+			// Neighbors of 'u' become neighbors of 'node'.
+			for (int w : adjacent[u]) {
+				if (w == node) continue;
+				vInt & back = adjacent[w];
+				back.erase(find(back.begin(),back.end(),u));
+				if (find(back.begin(),back.end(),node) == back.end()) back.push_back(node);
+				adj.push_back(w);
+			}
+			adjacent[u].clear();
+		}
+		adj.erase(remove_if(adj.begin(),adj.end(),[&](int w) {return !alive[w];}),adj.end());
+		sort(adj.begin(),adj.end());
+		adj.erase(unique(adj.begin(),adj.end()),adj.end());
+	}
+	
+	// A quick move: the node and color that merge the most neighbors, ties broken at random.
+	// With chance 'randomness', any legal move instead. Returns (node, color).
+	pair<int,int> pick(mt19937 & rng, double randomness) const {
+		if (uniform_real_distribution<double>(0,1)(rng) < randomness) {
+			vInt nodes;
+			for (int node = 0; node < (int)alive.size(); node++) {
+				if (alive[node]) nodes.push_back(node);
+			}
+			int node = nodes[uniform_int_distribution<int>(0,nodes.size() - 1)(rng)];
+			const vInt & adj = adjacent[node];
+			return {node,colors[adj[uniform_int_distribution<int>(0,adj.size() - 1)(rng)]]};
+		}
+		pair<int,int> best = {-1,-1};
+		int bestMerged = 0;
+		int ties = 0;
+		unordered_map<int,int> merged; // Neighbors of each color.
+		for (int node = 0; node < (int)alive.size(); node++) {
+			if (!alive[node]) continue;
+			merged.clear();
+			for (int other : adjacent[node]) merged[colors[other]]++;
+			for (auto & entry : merged) {
+				if (entry.second < bestMerged) continue;
+				if (entry.second > bestMerged) {
+					bestMerged = entry.second;
+					ties = 0;
+				}
+				// Keeps each of the tied moves with equal chance.
+				if (uniform_int_distribution<int>(0,ties++)(rng) == 0) best = {node,entry.first};
+			}
+		}
+		return best;
+	}
+};
+
+// Monte Carlo tree search, for an answer that keeps getting better the longer it runs.
+// Each iteration walks down the tree by UCT, claims the leaf it reaches, builds its path by replaying
+// the moves down to it, notes its moves (with bounds from 'Path::moveOptions', so children aren't
+// built until claimed), then plays it out with quick greedy moves on a 'Playout'. Shorter playouts
+// score higher, and each one shorter than the best is reported. A playout is cut off as soon as it can't beat the best.
+// Threads share the tree without locks. A visit is counted on the way down and scored on the way
+// back up (a 'virtual loss' meanwhile), so threads spread out rather than all taking the same line,
+// and a leaf is claimed by whichever thread swaps its state first.
+// Moves that can't beat the best solution so far (or 'maxSol') are never taken. Once none are left
+// anywhere in the tree, the best solution is proven optimal.
+class MonteCarloSearch {
+protected:
+	struct Node {
+		Move move; // From the parent, by original zone. Unused for the root.
+		int bound; // Moves made plus lower bound.
+		bool done;
+		atomic<int> state{0}; // 0: a leaf, 1: being claimed, 2: claimed (its children are set).
+		atomic<bool> exhausted{false}; // Nothing below it can beat the best solution.
+		atomic<unsigned long> visits{0};
+		atomic<long> reward{0}; // The sum of playout scores, in millionths.
+		vector<unique_ptr<Node>> children;
+		Node(Move move, int bound, bool done) : move(move), bound(bound), done(done) {}
+	};
+	static constexpr double exploration = 0.4; // How much UCT favors rarely visited moves.
+	static constexpr double randomness = 0.1; // How often playouts make a random move.
+	graph original;
+	vector<vector<int>> & zoneMap;
+	SolveOptions & options;
+	uint threadCount;
+	unique_ptr<Node> root;
+	Path first; // The root's path. Nodes don't keep theirs, which would soon fill memory.
+	int rootBound = 1;
+	atomic<int> bestLength; // Solutions must be shorter than this. INT_MAX for no limit.
+	atomic<bool> stop{false};
+	atomic<bool> limited{false}; // Set if a time or node limit was reached.
+	atomic<unsigned long> count{0};
+	mutex solutionLock;
+	chrono::steady_clock::time_point start;
+	
+	// Playouts of as few moves as the root's lower bound score 1. Longer ones score less.
+	long score(int length) {return length == 0 ? 1000000 : 1000000L * rootBound / length;}
+	
+	void report(const Path & p) {
+		lock_guard<mutex> guard(solutionLock);
+		if (p.moveCount() >= bestLength) return;
+		bestLength = p.moveCount();
+		solution = p.zoneMoves();
+		if (options.showCount) cout << "Found new solution: " << p.moveCount() << " moves.\n";
+		if (options.onImprove) options.onImprove(p.moveList(zoneMap));
+	}
+	
+	// Builds the path to the last node of 'line', which is being claimed, and notes the moves from it
+	// that could still win.
+	Path claim(const vector<Node *> & line) {
+		Path path = first;
+		for (size_t i = 1; i < line.size(); i++) path = path.makeZoneMove(line[i]->move.zone,line[i]->move.color);
+		Node * node = line.back();
+		if (node->done) return path;
+		int limit = bestLength;
+		for (auto & option : path.moveOptions(limit == INT_MAX ? -1 : limit,symmetry)) {
+			node->children.push_back(make_unique<Node>(option.move,option.bound,option.done));
+		}
+		return path;
+	}
+	
+	// Plays 'path' out with quick moves, reporting it if it wins in time. Its score, or that of
+	// 'bestLength' if it was cut off for being unable to beat it.
+	long playOut(Path & path, mt19937 & rng) {
+		Playout end(path.current());
+		int made = path.moveCount();
+		while (!end.done()) {
+			int limit = bestLength;
+			if (made + (int)end.moves.size() + end.lowerBound() >= limit) return score(limit);
+			pair<int,int> m = end.pick(rng,randomness);
+			end.makeMove(m.first,m.second);
+		}
+		int length = made + end.moves.size();
+		if (length < bestLength) {
+			vInt zones = path.zoneOfNodes();
+			Path p = path;
+			for (auto & m : end.moves) p = p.makeZoneMove(zones[m.first],m.second);
+			report(p);
+		}
+		return score(length);
+	}
+	
+	// The child UCT picks, skipping those that can't beat 'limit'. Null if there are none.
+	Node * select(Node * node, int limit) {
+		double logVisits = log((double)max(1ul,node->visits.load()));
+		Node * best = nullptr;
+		double bestValue = -1;
+		for (auto & child : node->children) {
+			if (child->exhausted or child->bound >= limit) continue;
+			unsigned long visits = child->visits;
+			if (visits == 0) return child.get();
+			double value = child->reward / 1e6 / visits + exploration * sqrt(logVisits / visits);
+			if (value > bestValue) {
+				bestValue = value;
+				best = child.get();
+			}
+		}
+		return best;
+	}
+	
+	// True if a claimed node has no child left that could beat 'limit'.
+	bool usedUp(Node * node, int limit) {
+		if (node->state != 2) return false;
+		for (auto & child : node->children) {
+			if (!child->exhausted and child->bound < limit) return false;
+		}
+		return true;
+	}
+	
+	// Returns false if it stopped at a leaf another thread was claiming, and so did nothing.
+	bool iterate(mt19937 & rng) {
+		vector<Node *> line = {root.get()};
+		root->visits++;
+		long reward = 0;
+		while (true) {
+			Node * node = line.back();
+			int state = node->state.load(memory_order_acquire);
+			if (state == 0 and node->state.compare_exchange_strong(state,1)) {
+				Path path = claim(line);
+				node->state.store(2,memory_order_release);
+				if (node->done) {
+					report(path);
+					node->exhausted = true;
+					reward = score(path.moveCount());
+					break;
+				}
+				reward = playOut(path,rng);
+				break;
+			}
+			if (state == 1) {
+				// Another thread is claiming it. Take back this walk's visits, and try again.
+				for (Node * n : line) n->visits--;
+				return false;
+			}
+			Node * next = select(node,bestLength);
+			if (next == nullptr) break;
+			next->visits++;
+			line.push_back(next);
+		}
+		for (Node * n : line) n->reward += reward;
+		// Anything left with nothing worth searching below it is used up, and so maybe its parent.
+		int limit = bestLength;
+		for (int i = line.size() - 1; i >= 0; i--) {
+			if (!line[i]->exhausted and !usedUp(line[i],limit)) break;
+			line[i]->exhausted = true;
+		}
+		return true;
+	}
+	
+	bool outOfLimits(unsigned long n) {
+		if (options.maxNodes != 0 and n > options.maxNodes) return true;
+		if (options.maxTime != 0 and chrono::steady_clock::now() - start > chrono::seconds(options.maxTime)) return true;
+		return false;
+	}
+	
+	void work(uint id) {
+		mt19937 rng(id + 1);
+		while (!stop) {
+			unsigned long n = ++count;
+			if (outOfLimits(n)) {
+				count--; // This one was not processed.
+				limited = true;
+				stop = true;
+				return;
+			}
+			if (!iterate(rng)) {
+				count--;
+				this_thread::yield();
+				continue;
+			}
+			// Done once nothing can beat the best, or it is as short as the hints say it can be.
+			if (root->exhausted or bestLength <= max(rootBound,options.minSol)) stop = true;
+		}
+	}
+	
+public:
+	vector<Move> solution;
+	unsigned long iterations = 0;
+	bool proven = false; // Set if the solution is known to be optimal.
+	Symmetries * symmetry = nullptr; // If set, symmetric moves are skipped.
+	
+	MonteCarloSearch(graph & original, vector<vector<int>> & zoneMap, SolveOptions & options) : original(original), zoneMap(zoneMap), options(options) {
+		threadCount = options.threads;
+		if (threadCount == 0) threadCount = max(1u,thread::hardware_concurrency());
+	}
+	
+	// Returns false if stopped by a time or node limit.
+	bool run() {
+		start = chrono::steady_clock::now();
+		bestLength = options.maxSol == -1 ? INT_MAX : options.maxSol;
+		if (original.nodeCount == 1) {
+			proven = true;
+			return true;
+		}
+		first = Path(original);
+		rootBound = first.lowerBound();
+		root = make_unique<Node>(Move{-1,-1,-1,-1},rootBound,false);
+		vector<thread> threads;
+		for (uint i = 0; i < threadCount; i++) threads.emplace_back(&MonteCarloSearch::work,this,i);
+		for (auto & t : threads) t.join();
+		iterations = count;
+		proven = !limited and (root->exhausted or bestLength <= rootBound);
+		return !limited;
+	}
+};
+
+// Takes a blank (-1 populated) 'zones' board, a 'colors' board,
+// an x,y, and zoneNum.
+// Fills the area of the 'zones' board which corresponds to the given zone in 'colors'
+void floodZone(board& zones, board& colors, uint x, uint y, uint zoneNum) {
+	uint width = zones[0].size();
+	uint height = zones.size();
+	queue<int> xs;
+	queue<int> ys;
+	xs.push(x);
+	ys.push(y);
+	int color = colors[y][x]; // The color to flood.
+	while (xs.size() != 0) {
+		x = pop(xs);
+		y = pop(ys);
+		if (zones[y][x] != -1) continue;
+		if (colors[y][x] != color) continue;
+		zones[y][x] = zoneNum;
+		if (x > 0) {
+			xs.push(x-1);
+			ys.push(y);
+		}
+		if (y > 0) {
+			xs.push(x);
+			ys.push(y-1);
+		}
+		if (x < width - 1) {
+			xs.push(x+1);
+			ys.push(y);
+		}
+		if (y < height - 1) {
+			xs.push(x);
+			ys.push(y+1);
+		}
+	}
+}
+
+// Takes a board (of colors), returns a board (of zones)
+board genZones(board rawInput, int& zoneCount, vector<int> & zoneColors) {
+	// Generate a blank board.
+	board result = rawInput;
+	// Clear board
+	for (auto& row : result) {
+		for (auto& val : row) {
+			val = -1;
+		}
+	}
+	uint height = result.size();
+	uint width = result[0].size();
+	int zoneNum = 0; // A counter for next free zone#
+	for (uint y = 0; y < height; y++) {
+		for (uint x = 0; x < width; x++) {
+			if (result[y][x] == -1) {
+				zoneColors.push_back(rawInput[y][x]);
+				floodZone(result,rawInput,x,y,zoneNum++);
+			}
+		}
+	}
+	zoneCount = zoneNum;
+	return result;
+}
+
+// Recolors the zone containing (x,y), flooding outwards.
+// Returns the number of cells changed (0 if the zone already has that color).
+int applyMove(board & b, int x, int y, int color) {
+	int old = b[y][x];
+	if (old == color) return 0;
+	int width = b[0].size();
+	int height = b.size();
+	int changed = 0;
+	queue<int> xs;
+	queue<int> ys;
+	xs.push(x);
+	ys.push(y);
+	while (xs.size() != 0) {
+		x = pop(xs);
+		y = pop(ys);
+		if (b[y][x] != old) continue;
+		b[y][x] = color;
+		changed++;
+		if (x > 0) {xs.push(x-1); ys.push(y);}
+		if (y > 0) {xs.push(x); ys.push(y-1);}
+		if (x < width - 1) {xs.push(x+1); ys.push(y);}
+		if (y < height - 1) {xs.push(x); ys.push(y+1);}
+	}
+	return changed;
+}
+
+graph genGraph(board zones, int zoneCount, vector<int> zoneColors) {
+	graph res;
+	res.nodeCount = zoneCount;
+	res.colors = zoneColors;
+	for (int i = 0; i < zoneCount; i++) res.adjacent[i] = unordered_set<int>();
+	uint height = zones.size();
+	uint width = zones[0].size();
+	for (uint y = 0; y < height; y++) {
+		for (uint x = 0; x < width; x++) {
+			if (x > 0 and zones[y][x] != zones[y][x-1]) {
+				res.adjacent[zones[y][x]].insert(zones[y][x-1]);
+				res.adjacent[zones[y][x-1]].insert(zones[y][x]);
+			}
+			if (y > 0 and zones[y][x] != zones[y-1][x]) {
+				res.adjacent[zones[y][x]].insert(zones[y-1][x]);
+				res.adjacent[zones[y-1][x]].insert(zones[y][x]);
+			}
+			// Only check above and left, since insertion is bidirectional.
+		}
+	}
+	return res;
+}
+
+
+// Runs FixedSearch<N,C> with the smaller color limit that fits.
+template <int N>
+bool runFixed(graph & g, SolveOptions & options, vector<Move> & moves, unsigned long & iterations) {
+	vector<pair<int,int>> solution;
+	bool res;
+	if (colorLimit(g) <= 16) {
+		FixedSearch<N,16> search(options);
+		res = search.run(g);
+		solution = search.solution;
+		iterations = search.iterations;
+	} else {
+		FixedSearch<N,64> search(options);
+		res = search.run(g);
+		solution = search.solution;
+		iterations = search.iterations;
+	}
+	moves.clear();
+	for (auto & m : solution) moves.push_back({m.first,-1,-1,m.second});
+	return res;
+}
+
+// Picks the smallest FixedSearch instantiation for the graph.
+// Returns false if it was stopped by a limit, like 'solve'.
+// Sets 'fits' to false if the graph is too large for any instantiation.
+bool solveFixed(graph & g, SolveOptions & options, vector<Move> & moves, unsigned long & iterations, bool & fits) {
+	fits = colorLimit(g) <= 64;
+	if (!fits) return false;
+	if (g.nodeCount <= 64) return runFixed<64>(g,options,moves,iterations);
+	if (g.nodeCount <= 128) return runFixed<128>(g,options,moves,iterations);
+	if (g.nodeCount <= 256) return runFixed<256>(g,options,moves,iterations);
+	if (g.nodeCount <= 1024) return runFixed<1024>(g,options,moves,iterations);
+	fits = false;
+	return false;
+}
+
+bool parseEngine(string name, Engine & engine) {
+	if (name == "best") {
+		engine = Engine::BestFirst;
+	} else if (name == "fixed") {
+		engine = Engine::Fixed;
+	} else if (name == "external") {
+		engine = Engine::External;
+	} else if (name == "parallel") {
+		engine = Engine::Parallel;
+	} else if (name == "hierarchical") {
+		engine = Engine::Hierarchical;
+	} else if (name == "mcts") {
+		engine = Engine::MonteCarlo;
+	} else if (name == "auto") {
+		engine = Engine::Auto;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+string engineName(Engine engine) {
+	switch (engine) {
+		case Engine::BestFirst: return "best";
+		case Engine::Fixed: return "fixed";
+		case Engine::External: return "external";
+		case Engine::Parallel: return "parallel";
+		case Engine::Hierarchical: return "hierarchical";
+		case Engine::MonteCarlo: return "mcts";
+		case Engine::Auto: return "auto";
+	}
+	return "?";
+}
+
+// Fills 'result' from the (optimal) move list found by an engine other than the default,
+// and reports failures the same way the default engine does.
+bool finishFromMoves(graph & startingPoint, vector<vector<int>> & zoneMap, SolveOptions & options, vector<Move> & moves, unsigned long iterations, bool fullSearch, SolveResult & result) {
+	result.complete = fullSearch;
+	// A full search with no moves only means the board was already solved.
+	if (fullSearch and replay(startingPoint,zoneMap,moves,result)) {
+		result.iterations = iterations;
+		result.proven = true;
+		result.lowerBound = result.moves.size();
+		if (options.showCount) cout << "Found new solution: " << moves.size() << " moves.\n";
+		if (options.onImprove) options.onImprove(result.moves);
+		return true;
+	}
+	result.iterations = iterations;
+	result.boards = {};
+	result.graphs = {};
+	result.moves = {};
+	if (options.quiet) return fullSearch;
+	if (!fullSearch) {
+		cout << "Timed out without finding a solution.\n";
+	} else {
+		cout << "Failed to find solution. Perhaps '-max=" << options.maxSol-1 <<"' was too restrictive?\n";
+	}
+	return fullSearch;
+}
+
+// Packs a best-first search into a snapshot. 'best' is only kept if it is a solution.
+// 'startColors' is the starting color of each zone.
+template <class Open, class Dedup>
+shared_ptr<Checkpoint> packCheckpoint(const vInt & startColors, Open & q, Dedup & seen, const Path & best, int maxSol, unsigned long iterations, double seconds) {
+	auto res = make_shared<Checkpoint>();
+	res->colors = startColors;
+	res->maxSol = maxSol;
+	res->iterations = iterations;
+	res->seconds = seconds;
+	if (best.done()) res->best = best.zoneMoves();
+	q.forEach([&](const Path & p) {res->addOpen(p.zoneMoves());});
+	seen.forEach([&](const PackedColoring & state, int moveCount) {res->addSeen(state.unpack(),moveCount);});
+	return res;
+}
+
+// Refills a best-first search from a snapshot: the duplicate table, the open list, and the best
+// solution. Open paths are replayed from 'start' in sorted order, so the moves they share are
+// only made once, then pushed in their saved order, so ties go the same way. Returns false, with a reason in 'error', if the snapshot isn't of this board.
+template <class Open, class Dedup>
+bool unpackCheckpoint(const Checkpoint & snapshot, Path & start, Open & q, Dedup & seen, Path & best, string & error) {
+	if (snapshot.colors != start.coloring().unpack()) {
+		error = "it was made for another board";
+		return false;
+	}
+	vector<Path> prefix = {start}; // The path after each move of the last path replayed.
+	vector<Move> last;
+	// Replays 'moves', reusing what it has in common with the last path.
+	auto replay = [&](const vector<Move> & moves) {
+		size_t common = 0;
+		while (common < last.size() and common < moves.size() and last[common].zone == moves[common].zone and last[common].color == moves[common].color) common++;
+		prefix.resize(common + 1);
+		for (size_t i = common; i < moves.size(); i++) {
+			if (!prefix.back().validZoneMove(moves[i].zone,moves[i].color)) {
+				error = "it has a move that doesn't fit this board";
+				return false;
+			}
+			Path next = prefix.back().makeZoneMove(moves[i].zone,moves[i].color);
+			prefix.push_back(move(next));
+		}
+		last = moves;
+		return true;
+	};
+	vector<vector<Move>> open = snapshot.open();
+	vInt order(open.size());
+	for (int i = 0; i < (int)open.size(); i++) order[i] = i;
+	sort(order.begin(),order.end(),[&](int a, int b) {
+		return lexicographical_compare(open[a].begin(),open[a].end(),open[b].begin(),open[b].end(),[](const Move & x, const Move & y) {
+			return x.zone != y.zone ? x.zone < y.zone : x.color < y.color;
+		});
+	});
+	vector<Path> paths(open.size());
+	for (int i : order) {
+		if (!replay(open[i])) return false;
+		paths[i] = prefix.back();
+		vector<Move>().swap(open[i]);
+	}
+	// Pushed in their saved order, each handed over as it goes so the open list is only held once.
+	for (auto & p : paths) q.push(p);
+	if (snapshot.best.size() > 0) {
+		if (!replay(snapshot.best)) return false;
+		best = prefix.back();
+	}
+	snapshot.forEachSeen([&](const vInt & state, int moveCount) {seen.restore(start.pack(state),moveCount);});
+	return true;
+}
+
+// The default engine: best-first search from 'start', with the policies of 'Strategy'.
+// 'trace' samples the search as it goes (see searchTrace.h).
+// If 'symmetry' is set, moves symmetric to another are skipped.
+// With 'options.checkpointPath', snapshots are saved as it goes, and when it runs out of time or nodes.
+// With 'options.resumePath', it carries on from one instead of starting afresh.
+template <class Strategy, class Trace>
+bool searchBestFirst(Path start, vector<vector<int>> & zoneMap, SolveOptions & options, SolveResult & result, Trace & trace, Symmetries * symmetry) {
+	bool fullSearch = true;
+	int minSol = options.minSol;
+	int maxSol = options.maxSol;
+	typename Strategy::Open q(options);
+	typename Strategy::Dedup seen;
+	int stoppedAt = -1; // The open list's lower bound, if stopped for being within it.
+	unique_ptr<MoveOrdering> ordering;
+	if (options.orderMoves) ordering = make_unique<MoveOrdering>(start);
+	Path best;
+	const vInt startColors = start.coloring().unpack(); // Kept, since 'start' may be moved into the open list.
+	unsigned long priorIterations = 0; // Processed before the snapshot resumed from.
+	double priorSeconds = 0;
+	if (options.resumePath != "") {
+		Checkpoint snapshot;
+		string error;
+		if (!snapshot.load(options.resumePath,error) or !unpackCheckpoint(snapshot,start,q,seen,best,error)) {
+			if (!options.quiet) cout << "Can't resume from '" << options.resumePath << "': " << error << ".\n";
+			result.boards = {};
+			result.graphs = {};
+			result.moves = {};
+			return false;
+		}
+		if (snapshot.maxSol != -1 and (maxSol == -1 or snapshot.maxSol < maxSol)) maxSol = snapshot.maxSol;
+		priorIterations = snapshot.iterations;
+		priorSeconds = snapshot.seconds;
+		if (options.showCount) {
+			cout << "Resumed after " << priorIterations << " board states and " << priorSeconds << " seconds, with ";
+			cout << q.size() << " open and " << seen.size() << " seen.\n";
+		}
+	} else if (seen.admit(start)) {
+		q.push(start);
+	}
+	unique_ptr<CheckpointWriter> writer;
+	if (options.checkpointPath != "") {
+		if (Checkpoint::fits(startColors)) {
+			writer = make_unique<CheckpointWriter>(options.checkpointPath);
+		} else if (!options.quiet) {
+			cout << "Colors over 255 can't be checkpointed. Searching without checkpoints.\n";
+		}
+	}
+	auto startTime = chrono::steady_clock::now();
+	auto maxTime = chrono::seconds(options.maxTime);
+	auto lastCheckpoint = startTime;
+	auto secondsSoFar = [&]() {
+		return priorSeconds + chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+	};
+	// Do the search.
+	unsigned long iterCount = 0;
+	while (q.size() > 0) {
+		iterCount++;
+		if (options.maxTime != 0 and chrono::steady_clock::now() - startTime > maxTime) {
+			fullSearch = false;
+			break;
+		}
+		if (options.maxNodes != 0 and iterCount > options.maxNodes) {
+			iterCount--; // This one was not processed.
+			fullSearch = false;
+			break;
+		}
+		// Packing is quick next to the search; the writing is done on another thread.
+		if (writer and chrono::steady_clock::now() - lastCheckpoint >= chrono::seconds(options.checkpointEvery)) {
+			lastCheckpoint = chrono::steady_clock::now();
+			if (writer->failed() and !options.quiet) cout << "Couldn't save checkpoint to '" << options.checkpointPath << "'.\n";
+			writer->write(packCheckpoint(startColors,q,seen,best,maxSol,priorIterations + iterCount - 1,secondsSoFar()));
+		}
+		if constexpr (Strategy::Open::bounded) {
+			// Nothing left can beat the best by more than 'epsilon'.
+			if (best.done() and (long)best.moveCount() * 1000 <= weightOf(options) * q.lowerBound()) {
+				stoppedAt = q.lowerBound();
+				break;
+			}
+		}
+		trace.sample(q.size(),seen.size(),maxSol,iterCount - 1);
+		Path p = q.pop();
+		trace.expanded(p.moveCount());
+		// update best, if needed
+		if (best.beaten(p)) {
+			best = p;
+			trace.improved(p.moveCount());
+			if (options.showCount) cout << "Found new solution: " << p.moveCount() << " moves.\n";
+			if (options.onImprove) options.onImprove(p.moveList(zoneMap));
+			if (ordering) {
+				vector<Move> path = p.zoneMoves();
+				for (int i = 0; i < (int)path.size(); i++) {
+					ordering->reward(path[i],path.size());
+					ordering->setKiller(path[i],i);
+				}
+			}
+			maxSol = p.moveCount(); // Update pruning distance.
+			if (maxSol <= minSol) break; // If we have reached an optimal solution, finish.
+		}
+		// If a solution has already been found, trim invalid solutions.
+		if (maxSol >= 0 and p.moveCount() + 1 >= maxSol) continue;
 		// cout << (string)p << "\n";
 		// Add following states.
-		for (Path pNew : p.followingStates(maxSol)) {
-			q.push(pNew);
+		vector<Path> children = p.followingStates(maxSol,false,symmetry);
+		if (ordering) ordering->sort(p,children);
+		for (Path & pNew : children) {
+			if (Strategy::Prune::keep(pNew,maxSol) and seen.admit(pNew)) q.push(pNew);
 		}
 	}
-	// cout << (string)best << "\n";
+	trace.finish(q.size(),seen.size(),maxSol,iterCount);
+	// Stopped early: save where it got to, so it can be carried on.
+	if (writer and !fullSearch) {
+		writer->wait();
+		writer->write(packCheckpoint(startColors,q,seen,best,maxSol,priorIterations + iterCount,secondsSoFar()));
+		writer->wait();
+		if (writer->failed() and !options.quiet) cout << "Couldn't save checkpoint to '" << options.checkpointPath << "'.\n";
+	}
+	result.iterations = priorIterations + iterCount;
+	result.complete = fullSearch;
 	if (!best.done()) {
-		result1 = {};
-		result2 = {};
-		iterations = iterCount;
+		result.boards = {};
+		result.graphs = {};
+		result.moves = {};
 		if (fullSearch == false) {
-			cout << "Timed out without finding a solution.\n";
+			if (!options.quiet) cout << "Timed out without finding a solution.\n";
 		} else if (maxSol > 0) {
-			cout << "Failed to find solution. Perhaps '-max=" << maxSol-1 <<"' was too restrictive?\n";
+			if (!options.quiet) cout << "Failed to find solution. Perhaps '-max=" << maxSol-1 <<"' was too restrictive?\n";
 			return true;
 		} else {
-			cout << "Failed to find result, for an unknown reason.\n";
+			if (!options.quiet) cout << "Failed to find result, for an unknown reason.\n";
 		}
 		return false;
 	}
-	if (minSol > 0 and maxSol > minSol) {
+	if (minSol > 0 and maxSol > minSol and !options.quiet) {
 		cout << "Note: 'minimum moves' value not reached!\n\texpected: ";
 		cout << minSol << " moves,\n\tgot: ";
 		cout << maxSol << " moves.\n";
 	}
-	result1 = best.applyHistory(zoneMap);
-	result2 = best.graphHistory();
-	iterations = iterCount;
+	result.boards = best.applyHistory(zoneMap);
+	result.graphs = best.graphHistory();
+	result.moves = best.moveList(zoneMap);
+	// Stopping at the '-min' hint, or within 'epsilon', means no proof of optimality.
+	result.proven = fullSearch and !(minSol > 0 and maxSol <= minSol) and stoppedAt == -1;
+	if (result.proven) result.lowerBound = maxSol;
+	if (stoppedAt != -1) result.lowerBound = min(stoppedAt,maxSol);
 	return fullSearch;
 }
 
-// TODO: add additional optimizations: color count, (max distance - 1) / 2
+// Picks the strategy chosen in 'options'.
+template <class Trace>
+bool searchWithTrace(Path start, vector<vector<int>> & zoneMap, SolveOptions & options, SolveResult & result, Trace & trace, Symmetries * symmetry) {
+	switch (options.strategy) {
+		case Strategy::AStar: return searchBestFirst<AStarStrategy>(start,zoneMap,options,result,trace,symmetry);
+		case Strategy::Greedy: return searchBestFirst<GreedyStrategy>(start,zoneMap,options,result,trace,symmetry);
+		case Strategy::Lean: return searchBestFirst<LeanStrategy>(start,zoneMap,options,result,trace,symmetry);
+		case Strategy::Bucket: return searchBestFirst<BucketStrategy>(start,zoneMap,options,result,trace,symmetry);
+		case Strategy::Weighted: return searchBestFirst<WeightedStrategy>(start,zoneMap,options,result,trace,symmetry);
+		case Strategy::Focal: return searchBestFirst<FocalStrategy>(start,zoneMap,options,result,trace,symmetry);
+		default: return searchBestFirst<ClassicStrategy>(start,zoneMap,options,result,trace,symmetry);
+	}
+}
+
+// Runs the best-first engine with the strategy chosen in 'options', tracing it if asked.
+bool searchBestFirst(Path start, vector<vector<int>> & zoneMap, SolveOptions & options, SolveResult & result, Symmetries * symmetry = nullptr) {
+	if (options.tracePath != "") {
+		SearchTrace trace(options.tracePath,options.traceInterval);
+		return searchWithTrace(start,zoneMap,options,result,trace,symmetry);
+	}
+	NullTrace trace;
+	return searchWithTrace(start,zoneMap,options,result,trace,symmetry);
+}
+
+bool parseStrategy(string name, Strategy & strategy) {
+	if (name == "classic") {
+		strategy = Strategy::Classic;
+	} else if (name == "astar") {
+		strategy = Strategy::AStar;
+	} else if (name == "greedy") {
+		strategy = Strategy::Greedy;
+	} else if (name == "lean") {
+		strategy = Strategy::Lean;
+	} else if (name == "bucket") {
+		strategy = Strategy::Bucket;
+	} else if (name == "weighted") {
+		strategy = Strategy::Weighted;
+	} else if (name == "focal") {
+		strategy = Strategy::Focal;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+string strategyName(Strategy strategy) {
+	switch (strategy) {
+		case Strategy::Classic: return "classic";
+		case Strategy::AStar: return "astar";
+		case Strategy::Greedy: return "greedy";
+		case Strategy::Lean: return "lean";
+		case Strategy::Bucket: return "bucket";
+		case Strategy::Weighted: return "weighted";
+		case Strategy::Focal: return "focal";
+	}
+	return "?";
+}
+
+bool parseTieBreak(string name, TieBreak & tieBreak) {
+	if (name == "deepest") {
+		tieBreak = TieBreak::Deepest;
+	} else if (name == "fifo") {
+		tieBreak = TieBreak::Fifo;
+	} else if (name == "lifo") {
+		tieBreak = TieBreak::Lifo;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+string tieBreakName(TieBreak tieBreak) {
+	switch (tieBreak) {
+		case TieBreak::Deepest: return "deepest";
+		case TieBreak::Fifo: return "fifo";
+		case TieBreak::Lifo: return "lifo";
+	}
+	return "?";
+}
 
+// Symmetries are only looked for on boards of up to this many zones.
+static const int exactFeatureZones = 1024;
+
+BoardFeatures boardFeatures(graph & g, vector<vector<int>> & zoneMap) {
+	BoardFeatures res;
+	res.zones = g.nodeCount;
+	res.colors = set<int>(g.colors.begin(),g.colors.end()).size();
+	res.diameter = DistTracker(g).greatest();
+	if (g.nodeCount <= exactFeatureZones) {
+		Symmetries symmetries;
+		findSymmetries(g,zoneMap,symmetries);
+		res.symmetries = symmetries.perms.size() + 1;
+	}
+	res.lowerBound = max(res.colors - 1,(res.diameter + 1) / 2);
+	return res;
+}
+
+// Thresholds for Engine::Auto, from solving 3ds_levels, and generated boards with
+// 'benchmark.py --engines=...' (which prints how the engines compare by zone count):
+// - With no time limit, Engine::Fixed with move ordering was the fastest exact engine on all but one
+//   level, often by 100x or more over Engine::BestFirst.
+// - Engine::Fixed has nothing to give if it runs out of time, and did on half the boards of 33 to 64
+//   zones with '-t=20'. So with a time limit, only engines that keep their best solution so far are used.
+// - With '-t=20', Engine::BestFirst solved every board of up to 32 zones in well under a second.
+//   Past that, Engine::MonteCarlo found the shortest solutions: over 51 solves of 33 to 300 zones, 15
+//   moves more than the best any engine found, to 51 for greedy best-first and 78 for Engine::BestFirst.
+// - A '-max=' hint leaves Engine::MonteCarlo nothing to improve on: only playouts that beat it count.
+//   On 3ds_levels (which all have hints) with '-t=30', Engine::BestFirst was faster on 9 of the 11 levels
+//   either engine took over half a second on, and Engine::MonteCarlo with symmetry pruning found
+//   nothing on b-9 at all.
+// - Past about 500 zones, only Engine::Hierarchical returned a solution at all.
+static const int autoMonteCarloZones = 32; // With a time limit, Engine::MonteCarlo is used above this.
+static const int autoExactZones = 500;
+
+SolveOptions chooseEngine(const BoardFeatures & features, const SolveOptions & options, string & reason) {
+	SolveOptions res = options;
+	reason = to_string(features.zones) + " zones, " + to_string(features.colors) + " colors, diameter " + to_string(features.diameter) + ", " + to_string(features.symmetries) + (features.symmetries == 1 ? " symmetry" : " symmetries") + ". ";
+	bool fixedFits = features.zones <= 1024 and features.colors <= 64;
+	uint cores = options.threads != 0 ? options.threads : thread::hardware_concurrency();
+	string why;
+	if (options.checkpointPath != "" or options.resumePath != "") {
+		res.engine = Engine::BestFirst;
+		why = "the only engine that saves checkpoints";
+	} else if (features.zones > autoExactZones) {
+		res.engine = Engine::Hierarchical;
+		why = "too many zones to search exactly, so the solution won't be proven optimal";
+	} else if (options.maxTime != 0 and options.maxSol == -1 and features.zones > autoMonteCarloZones) {
+		res.engine = Engine::MonteCarlo;
+		why = "unlikely to be solved exactly in time, and it keeps improving its solution until then";
+	} else if (options.maxTime != 0) {
+		res.engine = Engine::BestFirst;
+		why = options.maxSol != -1 ? "the '-max=' hint lets it prune, and it keeps its best solution if it runs out of time" : "likely to be solved exactly in time, and it keeps its best solution if not";
+	} else if (fixedFits) {
+		res.engine = Engine::Fixed;
+		res.orderMoves = true;
+		why = "the fastest exact engine, and it uses little memory";
+	} else if (cores > 1) {
+		res.engine = Engine::Parallel;
+		res.orderMoves = true;
+		why = "too many colors for '-engine=fixed', and there are cores to spare";
+	} else {
+		res.engine = Engine::BestFirst;
+		why = "too many colors for '-engine=fixed'";
+	}
+	// Engine::Fixed and Engine::Hierarchical don't prune symmetric moves.
+	if (features.symmetries > 1 and res.engine != Engine::Fixed and res.engine != Engine::Hierarchical) res.symmetry = true;
+	reason += "Using '-engine=" + engineName(res.engine) + "'";
+	if (res.orderMoves and !options.orderMoves) reason += " with '-orderMoves'";
+	if (res.symmetry and !options.symmetry) reason += (res.orderMoves and !options.orderMoves) ? " and '-symmetry'" : " with '-symmetry'";
+	reason += ": " + why + ".";
+	return res;
+}
+
+// Runs the engine chosen in 'options'. 'symmetry' is passed to the engines that search Paths.
+bool runEngine(graph & startingPoint, vector<vector<int>> & zoneMap, SolveOptions & options, SolveResult & result, Symmetries * symmetry) {
+	if (options.engine == Engine::Fixed) {
+		vector<Move> moves;
+		unsigned long iterations = 0;
+		bool fits;
+		bool fullSearch = solveFixed(startingPoint,options,moves,iterations,fits);
+		if (fits) return finishFromMoves(startingPoint,zoneMap,options,moves,iterations,fullSearch,result);
+		if (!options.quiet) cout << "Board too large for '-engine=fixed'. Using the default engine.\n";
+	}
+	if (options.engine == Engine::External) {
+		if (ExternalSearch::fits(startingPoint)) {
+			ExternalSearch search(startingPoint,options);
+			search.symmetry = symmetry;
+			bool fullSearch = search.run();
+			return finishFromMoves(startingPoint,zoneMap,options,search.solution,search.iterations,fullSearch,result);
+		}
+		if (!options.quiet) cout << "Board too large for '-engine=external'. Using the default engine.\n";
+	}
+	if (options.engine == Engine::Parallel) {
+		ParallelSearch search(startingPoint,options);
+		search.symmetry = symmetry;
+		bool fullSearch = search.run();
+		return finishFromMoves(startingPoint,zoneMap,options,search.solution,search.iterations,fullSearch,result);
+	}
+	if (options.engine == Engine::Hierarchical) return solveHierarchical(startingPoint,zoneMap,options,result);
+	if (options.engine == Engine::MonteCarlo) {
+		MonteCarloSearch search(startingPoint,zoneMap,options);
+		search.symmetry = symmetry;
+		bool fullSearch = search.run();
+		// Unlike the exact engines, a search stopped early still has its best solution to give.
+		// So does one stopped at the '-min' hint, which has proven nothing.
+		if (search.solution.size() > 0 or startingPoint.nodeCount == 1) {
+			replay(startingPoint,zoneMap,search.solution,result);
+			result.iterations = search.iterations;
+			result.complete = fullSearch;
+			result.proven = search.proven;
+			if (search.proven) result.lowerBound = result.moves.size();
+			return fullSearch;
+		}
+		return finishFromMoves(startingPoint,zoneMap,options,search.solution,search.iterations,fullSearch,result);
+	}
+	return searchBestFirst(Path(startingPoint),zoneMap,options,result,symmetry);
+}
+
+// Solves the problem, and returns results to 'result'.
+// The boolean result is 'true' unless it times out (or runs out of nodes).
+bool solve(graph startingPoint, vector<vector<int>> zoneMap, SolveOptions & options, SolveResult & result) {
+	if (options.engine == Engine::Auto) {
+		string reason;
+		SolveOptions chosen = chooseEngine(boardFeatures(startingPoint,zoneMap),options,reason);
+		if (!options.quiet) cout << "Engine 'auto': " << reason << "\n";
+		return solve(startingPoint,zoneMap,chosen,result);
+	}
+	result.engine = options.engine;
+	resetMemoryPeaks();
+	vector<MemoryUse> before = memoryUse();
+	Symmetries symmetries;
+	if (options.symmetry) findSymmetries(startingPoint,zoneMap,symmetries);
+	bool res = runEngine(startingPoint,zoneMap,options,result,options.symmetry ? &symmetries : nullptr);
+	if (options.symmetry) {
+		result.symmetries = symmetries.perms.size() + 1;
+		result.symmetriesGeneral = symmetries.general;
+		result.symmetryConsidered = symmetries.considered;
+		result.symmetryPruned = symmetries.pruned;
+	}
+	result.memory = memoryUse();
+	for (uint i = 0; i < before.size(); i++) result.memory[i].allocations -= before[i].allocations;
+	return res;
+}
+
+// Replays a list of moves (by zone #) from the starting point, and returns results like 'solve'.
+// Returns false if the moves are not legal, or do not solve the board.
+bool replay(graph startingPoint, vector<vector<int>> zoneMap, const vector<Move> & moveList, SolveResult & result) {
+	Path p(startingPoint);
+	for (auto & m : moveList) {
+		if (!p.validZoneMove(m.zone,m.color)) return false;
+		p = p.makeZoneMove(m.zone,m.color);
+	}
+	if (!p.done()) return false;
+	result.boards = p.applyHistory(zoneMap);
+	result.graphs = p.graphHistory();
+	result.moves = p.moveList(zoneMap);
+	result.iterations = 0;
+	result.complete = true;
+	return true;
+}
+
+// Finds the optimal move count with 'solve', then counts every solution of that length.
+// The solve is made to prove its solution optimal: the '-min=' hint is dropped, strategies that stop
+// within eps of optimal become Strategy::Classic, and engines that don't prove anything become
+// Engine::BestFirst (after Engine::Auto has picked one).
+bool countSolutions(graph startingPoint, vector<vector<int>> zoneMap, SolveOptions & options, uint examples, function<void(const vector<Move> &)> onSolution, CountResult & result) {
+	SolveOptions proving = options;
+	if (proving.engine == Engine::Auto) {
+		string reason;
+		proving = chooseEngine(boardFeatures(startingPoint,zoneMap),proving,reason);
+	}
+	proving.minSol = 0;
+	if (proving.strategy == Strategy::Weighted or proving.strategy == Strategy::Focal) proving.strategy = Strategy::Classic;
+	if (proving.engine == Engine::Hierarchical) proving.engine = Engine::BestFirst;
+	SolveResult solved;
+	result = CountResult();
+	result.complete = solve(startingPoint,zoneMap,proving,solved);
+	result.iterations = solved.iterations;
+	if (!result.complete or solved.boards.size() == 0) return result.complete;
+	result.moves = solved.moves.size();
+	if (result.moves == 0) {
+		result.solutions = 1; // Already solved: the empty move list is the only solution.
+		return true;
+	}
+	SolutionCounter counter(result.moves,options,zoneMap,examples,onSolution);
+	result.complete = counter.run(startingPoint,result.solutions);
+	result.iterations += counter.iterations;
+	return result.complete;
+}
+
+// Search state kept in a SolveSession between solves.
+struct SearchCache {
+	DistTracker dists; // The distances of the session's graph.
+};
+
+// Renumbers zone 'from' as 'to' (which must be unused) in a session's zone map and graph.
+void renameZone(SolveSession & session, int from, int to) {
+	for (auto & row : session.zones) {
+		for (auto & val : row) {
+			if (val == from) val = to;
+		}
+	}
+	graph & g = session.graph;
+	g.colors[to] = g.colors[from];
+	g.adjacent[to] = g.adjacent[from];
+	g.adjacent.erase(from);
+	for (int n : g.adjacent[to]) {
+		g.adjacent[n].erase(from);
+		g.adjacent[n].insert(to);
+	}
+}
+
+// Applies edits to a session's board, and rebuilds only the zones touching an edited cell.
+// Other zones keep their numbers, except to fill gaps left when fewer zones are rebuilt.
+// Fills 'oldToNew' (-1 for rebuilt zones) and 'changed' (the rebuilt zones), as DistTracker needs.
+void editZones(SolveSession & session, const vector<CellEdit> & edits, vInt & oldToNew, vInt & changed) {
+	board & cells = session.cells;
+	board & zones = session.zones;
+	graph & g = session.graph;
+	int height = cells.size();
+	int width = cells[0].size();
+	int oldCount = g.nodeCount;
+	// A recolored cell can split its zone, or join its neighbors' zones.
+	vector<bool> affected(oldCount,false);
+	for (auto & e : edits) {
+		if (e.x < 0 or e.x >= width or e.y < 0 or e.y >= height or e.color < 0) continue;
+		if (cells[e.y][e.x] == e.color) continue;
+		cells[e.y][e.x] = e.color;
+		affected[zones[e.y][e.x]] = true;
+		if (e.x > 0) affected[zones[e.y][e.x-1]] = true;
+		if (e.y > 0) affected[zones[e.y-1][e.x]] = true;
+		if (e.x < width - 1) affected[zones[e.y][e.x+1]] = true;
+		if (e.y < height - 1) affected[zones[e.y+1][e.x]] = true;
+	}
+	// Unlink the affected zones from the graph, and clear their cells.
+	vInt freeZones;
+	for (int z = 0; z < oldCount; z++) {
+		oldToNew.push_back(affected[z] ? -1 : z);
+		if (!affected[z]) continue;
+		freeZones.push_back(z);
+		for (int n : g.adjacent[z]) g.adjacent[n].erase(z);
+		g.adjacent.erase(z);
+	}
+	vector<pair<int,int>> cleared;
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			if (!affected[zones[y][x]]) continue;
+			zones[y][x] = -1;
+			cleared.push_back({x,y});
+		}
+	}
+	// Flood the cleared cells into new zones, reusing the freed numbers first.
+	uint used = 0;
+	for (auto & cell : cleared) {
+		int x = cell.first;
+		int y = cell.second;
+		if (zones[y][x] != -1) continue;
+		int zone = used < freeZones.size() ? freeZones[used] : g.nodeCount++;
+		used++;
+		if (zone == (int)g.colors.size()) g.colors.push_back(-1);
+		g.colors[zone] = cells[y][x];
+		g.adjacent[zone]; // Make blank adjacency set.
+		floodZone(zones,cells,x,y,zone);
+		changed.push_back(zone);
+	}
+	for (auto & cell : cleared) {
+		int x = cell.first;
+		int y = cell.second;
+		int zone = zones[y][x];
+		vector<pair<int,int>> near;
+		if (x > 0) near.push_back({x-1,y});
+		if (y > 0) near.push_back({x,y-1});
+		if (x < width - 1) near.push_back({x+1,y});
+		if (y < height - 1) near.push_back({x,y+1});
+		for (auto & n : near) {
+			int zone2 = zones[n.second][n.first];
+			if (zone2 == zone) continue;
+			g.adjacent[zone].insert(zone2);
+			g.adjacent[zone2].insert(zone);
+		}
+	}
+	// Fill the unused freed numbers by moving the highest zones down.
+	set<int> holes(freeZones.begin() + min<size_t>(used,freeZones.size()),freeZones.end());
+	while (holes.size() > 0) {
+		int top = g.nodeCount - 1;
+		if (holes.count(top) == 0) {
+			int hole = *holes.begin();
+			renameZone(session,top,hole);
+			oldToNew[top] = hole; // Only unchanged zones are above the holes.
+		}
+		holes.erase(holes.count(top) ? top : *holes.begin());
+		g.nodeCount--;
+		g.colors.pop_back();
+	}
+}
+
+// Solves a session's graph. With no 'known' solution, that is a plain 'solve'. If 'known' is given,
+// it is a solution already, so only shorter ones are searched for, starting from the cached distances.
+bool solveSession(SolveSession & session, SolveOptions & options, vector<Move> * known) {
+	graph & g = session.graph;
+	SolveResult & result = session.result;
+	result = SolveResult();
+	Path start(g,session.cache->dists);
+	if (known != nullptr and options.maxSol != -1 and (int)known->size() >= options.maxSol) known = nullptr; // Too long to use.
+	if (known == nullptr) return solve(g,session.zones,options,result);
+	int length = known->size();
+	bool fullSearch = true;
+	unsigned long iterations = 0;
+	// Nothing shorter is possible (or wanted) than the lower bound (or the '-min' hint).
+	if (length > max(start.lowerBound(),options.minSol)) {
+		SolveOptions bounded = options;
+		bounded.maxSol = length;
+		bounded.quiet = true;
+		if (options.engine == Engine::BestFirst) {
+			fullSearch = searchBestFirst(start,session.zones,bounded,result);
+		} else {
+			fullSearch = solve(g,session.zones,bounded,result);
+		}
+		if (result.boards.size() > 0) return fullSearch;
+		iterations = result.iterations;
+	}
+	replay(g,session.zones,*known,result);
+	result.iterations = iterations;
+	result.complete = fullSearch;
+	result.proven = fullSearch and (length <= start.lowerBound() or length > options.minSol);
+	if (options.showCount) cout << "Found new solution: " << length << " moves.\n";
+	if (options.onImprove) options.onImprove(result.moves);
+	return fullSearch;
+}
+
+bool startSession(board cells, SolveOptions & options, SolveSession & session) {
+	session.cells = cells;
+	int zoneCount;
+	vector<int> zoneColors;
+	session.zones = genZones(cells,zoneCount,zoneColors);
+	session.graph = genGraph(session.zones,zoneCount,zoneColors);
+	session.cache = make_shared<SearchCache>();
+	session.cache->dists = DistTracker(session.graph);
+	return solveSession(session,options,nullptr);
+}
+
+bool resolve(SolveSession & session, const vector<CellEdit> & edits, SolveOptions & options) {
+	board before = session.cells;
+	vector<Move> previous = session.result.moves;
+	vInt oldToNew;
+	vInt changed;
+	editZones(session,edits,oldToNew,changed);
+	session.cache->dists = DistTracker(session.graph,session.cache->dists,oldToNew,changed);
+	// Try the last solution as it is, and after undoing the edits.
+	vector<vector<Move>> candidates = {previous,{}};
+	for (int i = edits.size() - 1; i >= 0; i--) {
+		const CellEdit & e = edits[i];
+		if (e.x < 0 or e.y < 0 or e.y >= (int)before.size() or e.x >= (int)before[0].size()) continue;
+		candidates[1].push_back({-1,e.x,e.y,before[e.y][e.x]});
+	}
+	candidates[1].insert(candidates[1].end(),previous.begin(),previous.end());
+	vector<Move> best;
+	bool found = false;
+	for (auto & candidate : candidates) {
+		if (previous.size() == 0 and session.result.boards.size() == 0) break; // Nothing to reuse.
+		board b = session.cells;
+		vector<Move> kept;
+		for (Move m : candidate) {
+			if (applyMove(b,m.x,m.y,m.color) == 0) continue; // Drop moves that do nothing now.
+			m.zone = session.zones[m.y][m.x];
+			kept.push_back(m);
+		}
+		bool solved = true;
+		for (auto & row : b) {
+			for (int val : row) {
+				if (val != b[0][0]) solved = false;
+			}
+		}
+		if (solved and (!found or kept.size() < best.size())) {
+			best = kept;
+			found = true;
+		}
+	}
+	return solveSession(session,options,found ? &best : nullptr);
+}
+
+// TODO: add additional optimizations: color count, (max distance - 1) / 2
@@ -3,9 +3,13 @@
 #ifndef Solver_H
 #define Solver_H
 
+#include <vector>
 #include <unordered_set>
 #include <unordered_map>
 #include <string>
+#include <functional>
+#include <memory>
+#include "memstats.h"
 
 // Describes a graph.
 struct Graph {
@@ -14,12 +18,170 @@ struct Graph {
 	std::unordered_map<int,std::unordered_set<int>> adjacent;
 };
 
+// A single move: recolor the zone containing cell (x,y) to 'color'.
+// 'zone' is the zone number (from genZones) that the cell belongs to.
+struct Move {
+	int zone;
+	int x;
+	int y;
+	int color;
+};
+
 // Takes a board of colors, returns a board of zone numbers.
 std::vector<std::vector<int>> genZones(std::vector<std::vector<int>> rawInput, int& zoneCount, std::vector<int> & zoneColors);
 
 
 struct Graph genGraph(std::vector<std::vector<int>> zones, int zoneCount, std::vector<int> zoneColors);
 
-bool solve(struct Graph startingPoint, std::vector<std::vector<int>> zoneMap, std::vector<std::vector<std::vector<int>>> & result1, std::vector<struct Graph> & result2, unsigned int maxTime, uint & iterations, int minSol, int maxSol);
+// Recolors the zone containing (x,y), flooding outwards. Returns the number of cells changed.
+int applyMove(std::vector<std::vector<int>> & board, int x, int y, int color);
+
+// The search algorithms 'solve' can use.
+enum class Engine {
+	BestFirst, // Best-first search over Paths, with duplicate detection. The default.
+	Fixed, // Iterative deepening over fixed-size states, for boards of up to 1024 zones and 64 colors.
+	External, // Breadth-first iterative deepening, with each layer of the frontier kept in sorted files on disk.
+	Parallel, // Depth-first iterative deepening over Paths, split across threads by work stealing.
+	Hierarchical, // Solves regions of the board separately, then the board they leave. Not optimal, but fast on huge boards.
+	MonteCarlo, // Monte Carlo tree search on several threads. Finds a solution at once, and better ones the longer it runs.
+	Auto, // Picks one of the others, and its settings, from the board's features (see 'chooseEngine').
+};
+
+// Converts between engines and their '-engine=' names. 'parseEngine' returns false for unknown names.
+bool parseEngine(std::string name, Engine & engine);
+std::string engineName(Engine engine);
+
+// Presets of ordering, duplicate detection and pruning for Engine::BestFirst.
+// The first five find optimal solutions; they differ in what they search first, and how much.
+enum class Strategy {
+	Classic, // Fewest nodes first, with exact duplicate detection. The default.
+	AStar, // Fewest moves made plus needed first, with hashed duplicate detection and lower bound pruning.
+	Greedy, // Fewest moves needed first, ignoring moves made. Finds a first solution fast.
+	Lean, // Classic ordering, with hashed duplicate detection and lower bound pruning.
+	Bucket, // Like AStar, but kept in one bucket per moves made plus needed, ties broken by 'SolveOptions::tieBreak'.
+	// The last two stop once their solution is provably within 'SolveOptions::epsilon' of optimal.
+	Weighted, // Weighted A*: fewest moves made plus 1+epsilon times moves needed first.
+	Focal, // Focal search: fewest nodes first, among paths within 1+epsilon of the best moves made plus needed.
+};
+
+// Converts between strategies and their '-strategy=' names. 'parseStrategy' returns false for unknown names.
+bool parseStrategy(std::string name, Strategy & strategy);
+std::string strategyName(Strategy strategy);
+
+// Which path Strategy::Bucket searches first, out of those with the same moves made plus needed.
+enum class TieBreak {
+	Deepest, // Most moves made, then last in. The default.
+	Fifo, // First in.
+	Lifo, // Last in.
+};
+
+// Converts between tie-breaks and their '-tieBreak=' names. 'parseTieBreak' returns false for unknown names.
+bool parseTieBreak(std::string name, TieBreak & tieBreak);
+std::string tieBreakName(TieBreak tieBreak);
+
+// Settings for a search.
+struct SolveOptions {
+	Engine engine = Engine::BestFirst;
+	Strategy strategy = Strategy::Classic; // The policies Engine::BestFirst uses.
+	unsigned int maxTime = 0; // Seconds before giving up. '0' means 'none'.
+	unsigned long maxNodes = 0; // Partial paths to process before giving up. '0' means 'none'.
+	int minSol = 0; // Stop once a solution this short is found.
+	int maxSol = -1; // Only look for solutions shorter than this. -1 means no cutoff.
+	bool showCount = false; // Print each new best solution as it is found.
+	bool quiet = false; // Don't print warnings and failures.
+	std::string spillDir = "/tmp"; // Where Engine::External keeps its files.
+	unsigned long memoryLimit = 256; // Megabytes of states Engine::External sorts in memory before writing a run.
+	unsigned int threads = 0; // Threads for Engine::Parallel and Engine::MonteCarlo. '0' means 'one per CPU core'.
+	unsigned int regionSize = 16; // Most zones in a region for Engine::Hierarchical.
+	unsigned long regionNodes = 20000; // Partial paths Engine::Hierarchical may process per region.
+	std::string tracePath; // Where Engine::BestFirst writes samples of its progress. Empty means none.
+	unsigned int traceInterval = 100; // Milliseconds between trace samples.
+	TieBreak tieBreak = TieBreak::Deepest; // For Strategy::Bucket.
+	double epsilon = 0.1; // For Strategy::Weighted and Strategy::Focal: how much longer than optimal a solution may be, as a fraction.
+	bool orderMoves = false; // Search the most promising moves first: killer and history scores, moves near the last one, central nodes.
+	std::string checkpointPath; // Where Engine::BestFirst saves snapshots of its search, to resume from. Empty means none.
+	unsigned int checkpointEvery = 300; // Seconds between snapshots.
+	std::string resumePath; // A snapshot for Engine::BestFirst to carry on from, instead of starting afresh. Empty means none.
+	bool symmetry = false; // Skip moves equivalent to another under an automorphism of the board. Not used by Engine::Fixed.
+	// Called with each new best solution, as it is found.
+	std::function<void(const std::vector<struct Move> &)> onImprove;
+};
+
+// The results of a search.
+struct SolveResult {
+	std::vector<std::vector<std::vector<int>>> boards; // The board after each move, starting with the input.
+	std::vector<struct Graph> graphs; // The graph after each move. Empty for Engine::Hierarchical.
+	std::vector<struct Move> moves;
+	unsigned long iterations = 0; // The number of partial paths processed.
+	bool complete = false; // False if the search ran out of time or nodes.
+	bool proven = false; // True if the solution is known to be optimal.
+	int lowerBound = -1; // The fewest moves any solution could take, as proven by the search. -1 if not known.
+	unsigned int symmetries = 0; // Automorphisms used by 'SolveOptions::symmetry', counting the identity. 0 if not looked for.
+	bool symmetriesGeneral = false; // True if those are every automorphism of the graph. Otherwise there were too many to check.
+	unsigned long symmetryConsidered = 0; // Moves looked at while pruning symmetric moves.
+	unsigned long symmetryPruned = 0; // Moves skipped as symmetric to another.
+	std::vector<MemoryUse> memory; // Memory by structure, with allocations made during the solve. Empty unless built with MEMSTATS.
+	Engine engine = Engine::BestFirst; // The engine that ran. For Engine::Auto, the one it picked.
+};
+
+bool solve(struct Graph startingPoint, std::vector<std::vector<int>> zoneMap, SolveOptions & options, SolveResult & result);
+
+// The results of counting optimal solutions.
+struct CountResult {
+	int moves = -1; // The optimal move count. -1 if no solution was found.
+	unsigned long long solutions = 0; // Distinct optimal move sequences. Stops growing at the largest value.
+	unsigned long iterations = 0; // Partial paths processed, by the solve and the count together.
+	bool complete = false; // False if either ran out of time or nodes.
+};
+
+// Solves the board, then counts the distinct move sequences as short as the solution.
+// The first 'examples' sequences found are passed to 'onSolution' as the count goes.
+// Returns false if it runs out of time or nodes (limits apply to the solve and the count separately).
+bool countSolutions(struct Graph startingPoint, std::vector<std::vector<int>> zoneMap, SolveOptions & options, unsigned int examples, std::function<void(const std::vector<struct Move> &)> onSolution, CountResult & result);
+
+// Recolors one cell, for 'resolve'.
+struct CellEdit {
+	int x;
+	int y;
+	int color;
+};
+
+// A board and its last solution, kept so that small edits can be re-solved quickly.
+struct SolveSession {
+	std::vector<std::vector<int>> cells; // The board's colors.
+	std::vector<std::vector<int>> zones; // The zone map, as from genZones.
+	struct Graph graph; // The zone graph, as from genGraph.
+	SolveResult result; // The last solution.
+	std::shared_ptr<struct SearchCache> cache; // Search state kept between solves.
+};
+
+// Solves a board from scratch, and keeps everything 'resolve' needs in 'session'.
+bool startSession(std::vector<std::vector<int>> cells, SolveOptions & options, SolveSession & session);
+
+// Applies cell edits to a session's board, and solves it again.
+// Only the zones touching an edited cell are rebuilt, and only the distances that could
+// have changed are recomputed. The last solution (replayed, with the edits undone first if
+// needed) gives an upper bound, so the search only looks for something shorter.
+// Returns false if it runs out of time or nodes, like 'solve'.
+bool resolve(SolveSession & session, const std::vector<CellEdit> & edits, SolveOptions & options);
+
+// What Engine::Auto looks at to pick an engine.
+struct BoardFeatures {
+	int zones = 0;
+	int colors = 0; // Distinct colors on the board.
+	int diameter = 0; // The greatest distance between two zones. Only a lower bound on boards of more than 128 zones.
+	int lowerBound = 0; // The fewest moves any solution could take, from the colors and the diameter.
+	unsigned int symmetries = 1; // Color-preserving automorphisms, counting the identity. Only looked for on boards small enough to search exactly.
+};
+
+BoardFeatures boardFeatures(struct Graph & g, std::vector<std::vector<int>> & zoneMap);
+
+// The engine and settings Engine::Auto runs for a board with 'features'. Everything else is kept
+// from 'options'. 'reason' is set to a short explanation of the choice, for the log.
+SolveOptions chooseEngine(const BoardFeatures & features, const SolveOptions & options, std::string & reason);
+
+// Replays a list of moves (only 'zone' and 'color' are used) and returns results like 'solve'.
+// Returns false if the moves are not legal, or do not solve the board.
+bool replay(struct Graph startingPoint, std::vector<std::vector<int>> zoneMap, const std::vector<struct Move> & moveList, SolveResult & result);
 
 #endif
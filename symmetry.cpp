@@ -0,0 +1,193 @@
+#include <vector>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <climits>
+#include "symmetry.h"
+
+using namespace std;
+typedef vector<int> vInt;
+typedef struct Graph graph;
+typedef vector<vector<int>> board;
+
+// Splits nodes into classes no automorphism can mix: same color, then the same
+// number of neighbors in each class, repeated until no class splits further.
+static vInt refinedClasses(graph & g) {
+	vInt classes = g.colors;
+	int classCount = -1;
+	while (true) {
+		map<vInt,int> ids;
+		vector<vInt> signatures(g.nodeCount);
+		for (int node = 0; node < g.nodeCount; node++) {
+			vInt & sig = signatures[node];
+			for (int other : g.adjacent[node]) sig.push_back(classes[other]);
+			sort(sig.begin(),sig.end());
+			sig.insert(sig.begin(),classes[node]);
+			ids[sig] = 0;
+		}
+		int next = 0;
+		for (auto & entry : ids) entry.second = next++;
+		for (int node = 0; node < g.nodeCount; node++) classes[node] = ids[signatures[node]];
+		// Refinement only ever splits classes, so an unchanged count means it is stable.
+		if (next == classCount) return classes;
+		classCount = next;
+	}
+}
+
+// Enumerates automorphisms by mapping nodes one at a time, in an order where each
+// node (after the first of its component) touches one already mapped.
+class AutomorphismSearch {
+protected:
+	graph & g;
+	vInt classes;
+	vector<vInt> members; // The nodes of each class.
+	vInt order;
+	vInt image; // The node each node maps to so far, or -1.
+	vector<bool> taken; // Nodes already used as an image.
+	unsigned int limit;
+	unsigned long budget = 1000000; // Search steps before giving up.
+
+	// True if mapping 'node' to 'target' keeps every edge to an already mapped node, and adds none.
+	bool consistent(int node, int target) {
+		int mappedNeighbors = 0;
+		for (int other : g.adjacent[node]) {
+			if (image[other] == -1) continue;
+			if (g.adjacent[target].count(image[other]) == 0) return false;
+			mappedNeighbors++;
+		}
+		int takenNeighbors = 0;
+		for (int other : g.adjacent[target]) takenNeighbors += taken[other];
+		return takenNeighbors == mappedNeighbors;
+	}
+
+	void extend(size_t depth) {
+		if (overflow) return;
+		if (depth == order.size()) {
+			bool identity = true;
+			for (int node = 0; node < g.nodeCount and identity; node++) identity = image[node] == node;
+			if (identity) return;
+			if (found.size() == limit) {
+				overflow = true;
+				return;
+			}
+			found.push_back(image);
+			return;
+		}
+		if (--budget == 0) overflow = true;
+		int node = order[depth];
+		for (int target : members[classes[node]]) {
+			if (taken[target] or !consistent(node,target)) continue;
+			image[node] = target;
+			taken[target] = true;
+			extend(depth + 1);
+			image[node] = -1;
+			taken[target] = false;
+			if (overflow) return;
+		}
+	}
+
+public:
+	vector<vInt> found;
+	bool overflow = false; // Set if there were more than 'limit' automorphisms, or the search ran too long.
+
+	AutomorphismSearch(graph & g, unsigned int limit) : g(g), limit(limit) {
+		classes = refinedClasses(g);
+		for (int node = 0; node < g.nodeCount; node++) {
+			if (classes[node] >= (int)members.size()) members.resize(classes[node] + 1);
+			members[classes[node]].push_back(node);
+		}
+		// Breadth-first from a node of the smallest class, so each choice is constrained early.
+		vInt starts(g.nodeCount);
+		for (int node = 0; node < g.nodeCount; node++) starts[node] = node;
+		stable_sort(starts.begin(),starts.end(),[&](int a, int b) {
+			return members[classes[a]].size() < members[classes[b]].size();
+		});
+		vector<bool> queued(g.nodeCount,false);
+		for (int first : starts) {
+			if (queued[first]) continue;
+			queued[first] = true;
+			size_t head = order.size();
+			order.push_back(first);
+			while (head < order.size()) {
+				int node = order[head++];
+				for (int other : g.adjacent[node]) {
+					if (queued[other]) continue;
+					queued[other] = true;
+					order.push_back(other);
+				}
+			}
+		}
+		image = vInt(g.nodeCount,-1);
+		taken = vector<bool>(g.nodeCount,false);
+	}
+
+	void run() {extend(0);}
+};
+
+// The board's mirror and rotation symmetries that keep every cell's color, as zone mappings.
+static vector<vInt> boardSymmetries(graph & g, board & zoneMap) {
+	set<vInt> res;
+	int h = zoneMap.size();
+	if (h == 0) return {};
+	int w = zoneMap[0].size();
+	// The eight ways to flip and turn a board. Those that swap x and y need it to be square.
+	for (int t = 1; t < 8; t++) {
+		bool swap = t >= 4;
+		if (swap and w != h) continue;
+		vInt perm(g.nodeCount,-1);
+		bool keeps = true;
+		for (int y = 0; y < h and keeps; y++) {
+			for (int x = 0; x < w and keeps; x++) {
+				int tx = (t & 1) ? w - 1 - x : x;
+				int ty = (t & 2) ? h - 1 - y : y;
+				if (swap) std::swap(tx,ty);
+				int from = zoneMap[y][x];
+				int to = zoneMap[ty][tx];
+				if (g.colors[from] != g.colors[to]) keeps = false;
+				perm[from] = to;
+			}
+		}
+		if (!keeps) continue;
+		bool identity = true;
+		for (int node = 0; node < g.nodeCount and identity; node++) identity = perm[node] == node;
+		if (!identity) res.insert(perm);
+	}
+	return vector<vInt>(res.begin(),res.end());
+}
+
+void findSymmetries(graph & g, board & zoneMap, Symmetries & result, unsigned int limit) {
+	AutomorphismSearch search(g,limit);
+	search.run();
+	result.considered = 0;
+	result.pruned = 0;
+	if (!search.overflow) {
+		result.perms = search.found;
+		result.general = true;
+		return;
+	}
+	// Too many to check them all. Keep the ones found, and make sure the board's own are there.
+	set<vInt> perms(search.found.begin(),search.found.end());
+	for (auto & perm : boardSymmetries(g,zoneMap)) perms.insert(perm);
+	result.perms = vector<vInt>(perms.begin(),perms.end());
+	result.general = false;
+}
+
+vector<bool> symmetricKeep(const Symmetries & symmetry, const vInt & colors, const vInt & nodeOf, int nodeCount) {
+	vector<bool> keep(nodeCount,true);
+	int zoneCount = colors.size();
+	vector<const vInt *> live;
+	for (auto & perm : symmetry.perms) {
+		bool fixes = true;
+		for (int zone = 0; zone < zoneCount and fixes; zone++) fixes = colors[perm[zone]] == colors[zone];
+		if (fixes) live.push_back(&perm);
+	}
+	if (live.size() == 0) return keep;
+	vInt lowest(nodeCount,INT_MAX); // The lowest original zone in each node.
+	for (int zone = 0; zone < zoneCount; zone++) lowest[nodeOf[zone]] = min(lowest[nodeOf[zone]],zone);
+	for (int node = 0; node < nodeCount; node++) {
+		for (auto perm : live) {
+			if (lowest[nodeOf[(*perm)[lowest[node]]]] < lowest[node]) keep[node] = false;
+		}
+	}
+	return keep;
+}
@@ -0,0 +1,33 @@
+#ifndef Symmetry_H
+#define Symmetry_H
+
+#include <vector>
+#include <atomic>
+#include "solver.h"
+
+// Color-preserving automorphisms of a zone graph, used to skip moves that are
+// mirror images of other moves. Two moves related by an automorphism lead to
+// equivalent boards, so only one of each such pair needs searching.
+struct Symmetries {
+	// Each automorphism maps zone # to zone #. The identity is not included.
+	// Need not be a whole group: pruning only ever drops a node some automorphism maps to a lower one,
+	// so the lowest node of each orbit is always kept.
+	std::vector<std::vector<int>> perms;
+	bool general = false; // True if these are every automorphism of the graph.
+	std::atomic<unsigned long> considered{0}; // Moves looked at while pruning.
+	std::atomic<unsigned long> pruned{0}; // Moves skipped as equivalent to another.
+};
+
+// Finds the automorphisms of 'g' (whose nodes are the zones of 'zoneMap').
+// They are enumerated by a search over the graph's refined partition. If there are more
+// than 'limit', the first 'limit' found are kept, along with the board's mirror and
+// rotation symmetries. Every automorphism is checked at each expansion, so more cost more.
+void findSymmetries(struct Graph & g, std::vector<std::vector<int>> & zoneMap, Symmetries & result, unsigned int limit = 64);
+
+// Which nodes of a later state are worth moving. 'colors' is the current color of each
+// original zone, and 'nodeOf' the node of 'nodeCount' that each zone is now part of.
+// Only automorphisms that keep 'colors' still apply. Of the nodes they map onto each
+// other, only the one holding the lowest original zone is kept.
+std::vector<bool> symmetricKeep(const Symmetries & symmetry, const std::vector<int> & colors, const std::vector<int> & nodeOf, int nodeCount);
+
+#endif